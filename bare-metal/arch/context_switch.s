@@ -22,6 +22,13 @@ context_switch:
     /* Store current SP into old task's TCB */
     str sp, [r0]
 
+    /*
+     * Drop any exclusive reservation left by the old task, so a task
+     * switched out between LDREX and STREX cannot have a later STREX
+     * succeed on a stale monitor.
+     */
+    clrex
+
     /* Switch to new task's stack */
     mov sp, r1
 
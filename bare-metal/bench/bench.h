@@ -0,0 +1,28 @@
+#ifndef RTOS_BENCH_H
+#define RTOS_BENCH_H
+
+/*
+ * Shared helpers for the host benchmarks (make -f Makefile.test bench).
+ * Output goes through kprintf so the same code can print on the UART.
+ */
+
+#include "types.h"
+#include "kprintf.h"
+#include <stdio.h>
+#include <time.h>
+
+static inline void bench_putc(char c) {
+    putchar(c);
+}
+
+static inline void bench_init(void) {
+    kprintf_init(bench_putc);
+}
+
+static inline uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+#endif /* RTOS_BENCH_H */
@@ -0,0 +1,207 @@
+/*
+ * bench_alloc.c - allocator latency (WCET) harness
+ *
+ * Drives an allocator through deterministic traces and reports min, mean,
+ * p99 and max cycles per my_malloc/my_free, plus the longest free list
+ * seen. Runs on the host (make -f Makefile.test bench) and as a kernel
+ * image in QEMU (make qemu-bench) using the Cortex-A7 cycle counter.
+ *
+ * New allocators are compared by adding an entry to allocators[].
+ */
+
+#include "types.h"
+#include "kprintf.h"
+#include "cycles.h"
+#include "mem.h"
+
+typedef struct {
+    const char *name;
+    void (*reset)(void);
+    void *(*alloc)(size_t nbytes);
+    void (*release)(void *ptr);
+    size_t (*free_list_len)(void);      /* NULL if not applicable */
+} BenchAllocator_t;
+
+#define MAX_SAMPLES 4096
+#define MAX_LIVE    512
+
+typedef struct {
+    uint32_t samples[MAX_SAMPLES];
+    uint32_t count;
+} Samples_t;
+
+static Samples_t alloc_samples;
+static Samples_t free_samples;
+static void *live[MAX_LIVE];
+static size_t max_free_list;
+
+/* --- K&R allocator adapter --- */
+
+static size_t kr_free_list_len(void) {
+    MemStats_t st;
+    mem_get_stats(&st);
+    return st.free_blocks;
+}
+
+static const BenchAllocator_t allocators[] = {
+    { "K&R + magazines", init_allocator, my_malloc, my_free, kr_free_list_len },
+};
+
+/* --- measurement --- */
+
+static void record(Samples_t *s, uint32_t cycles) {
+    if (s->count < MAX_SAMPLES)
+        s->samples[s->count++] = cycles;
+}
+
+static void *timed_alloc(const BenchAllocator_t *a, size_t n) {
+    uint32_t t0 = cycles_read();
+    void *p = a->alloc(n);
+    uint32_t t1 = cycles_read();
+    record(&alloc_samples, t1 - t0);
+    if (a->free_list_len) {
+        size_t len = a->free_list_len();
+        if (len > max_free_list)
+            max_free_list = len;
+    }
+    return p;
+}
+
+static void timed_free(const BenchAllocator_t *a, void *p) {
+    uint32_t t0 = cycles_read();
+    a->release(p);
+    uint32_t t1 = cycles_read();
+    record(&free_samples, t1 - t0);
+}
+
+static void sort_samples(Samples_t *s) {
+    /* Shell sort: no libc, fine for a few thousand samples */
+    for (uint32_t gap = s->count / 2; gap > 0; gap /= 2) {
+        for (uint32_t i = gap; i < s->count; i++) {
+            uint32_t v = s->samples[i];
+            uint32_t j = i;
+            while (j >= gap && s->samples[j - gap] > v) {
+                s->samples[j] = s->samples[j - gap];
+                j -= gap;
+            }
+            s->samples[j] = v;
+        }
+    }
+}
+
+static void report(const char *op, Samples_t *s) {
+    if (s->count == 0)
+        return;
+    sort_samples(s);
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < s->count; i++)
+        sum += s->samples[i];
+    uint32_t p99 = s->samples[(s->count * 99) / 100];
+    kprintf("    %s: n=%u min=%u mean=%u p99=%u max=%u\n", op, s->count,
+            s->samples[0], (uint32_t)(sum / s->count), p99,
+            s->samples[s->count - 1]);
+}
+
+/* --- traces --- */
+
+static uint32_t rng_state;
+
+static uint32_t next_rand(void) {
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+/* Random mix of sizes and lifetimes, fixed seed for repeatability */
+static void trace_random(const BenchAllocator_t *a) {
+    rng_state = 12345;
+    for (int i = 0; i < MAX_SAMPLES; i++) {
+        int slot = (int)(next_rand() % MAX_LIVE);
+        if (live[slot]) {
+            timed_free(a, live[slot]);
+            live[slot] = NULL;
+        } else {
+            live[slot] = timed_alloc(a, 8 + next_rand() % 1024);
+        }
+    }
+}
+
+/*
+ * Worst case for first fit: leave a long list of holes that are too small
+ * for later requests, so each large allocation walks every hole, then free
+ * in an order that makes each free search the address-ordered list.
+ */
+static void trace_fragment(const BenchAllocator_t *a) {
+    int holes = MAX_LIVE / 2;
+    for (int i = 0; i < MAX_LIVE; i++)
+        live[i] = a->alloc(128);
+    for (int i = 0; i < MAX_LIVE; i += 2) {
+        a->release(live[i]);
+        live[i] = NULL;
+    }
+    for (int i = 0; i < holes; i += 2)
+        live[i] = timed_alloc(a, 1024);
+    for (int i = MAX_LIVE - 1; i >= 0; i--) {
+        if (live[i]) {
+            timed_free(a, live[i]);
+            live[i] = NULL;
+        }
+    }
+}
+
+typedef struct {
+    const char *name;
+    void (*run)(const BenchAllocator_t *a);
+} Trace_t;
+
+static const Trace_t traces[] = {
+    { "random",    trace_random },
+    { "fragment",  trace_fragment },
+};
+
+static void bench_alloc_run(void) {
+    cycles_init();
+    kprintf("allocator latency (cycles)\n");
+    for (size_t i = 0; i < sizeof(allocators) / sizeof(allocators[0]); i++) {
+        const BenchAllocator_t *a = &allocators[i];
+        kprintf("%s\n", a->name);
+        for (size_t t = 0; t < sizeof(traces) / sizeof(traces[0]); t++) {
+            a->reset();
+            rt_memset(live, 0, sizeof(live));
+            alloc_samples.count = 0;
+            free_samples.count = 0;
+            max_free_list = 0;
+
+            traces[t].run(a);
+
+            kprintf("  trace %s:\n", traces[t].name);
+            report("alloc", &alloc_samples);
+            report("free ", &free_samples);
+            if (a->free_list_len)
+                kprintf("    max free list: %u blocks\n", (uint32_t)max_free_list);
+        }
+    }
+}
+
+#if defined(__arm__) && !__STDC_HOSTED__
+
+#include "uart.h"
+
+void kernel_main(void) {
+    uart_init();
+    kprintf_init(uart_putc);
+    bench_alloc_run();
+    while (1)
+        __asm__ volatile("wfi");
+}
+
+#else
+
+#include "bench.h"
+
+int main(void) {
+    bench_init();
+    bench_alloc_run();
+    return 0;
+}
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * bench_arena.c - per-object my_free vs arena_reset for scratch memory
+ *
+ * Models a packet handler that allocates OBJS_PER_MSG small objects per
+ * message and releases them all when the message is done.
+ */
+
+#include "bench.h"
+#include "mem.h"
+
+#define MESSAGES     20000
+#define OBJS_PER_MSG 32
+#define LIVE_OBJS    64
+
+static size_t obj_size(int i) {
+    return 16 + (size_t)((i * 37) % 112);
+}
+
+/* Long-lived allocations so the free list is not trivially short */
+static void populate_heap(void **live) {
+    for (int i = 0; i < LIVE_OBJS; i++)
+        live[i] = my_malloc(obj_size(i) * 2);
+    for (int i = 0; i < LIVE_OBJS; i += 2)
+        my_free(live[i]);
+}
+
+static uint64_t run_malloc_free(void) {
+    void *objs[OBJS_PER_MSG];
+    uint64_t start = bench_now_ns();
+    for (int m = 0; m < MESSAGES; m++) {
+        for (int i = 0; i < OBJS_PER_MSG; i++)
+            objs[i] = my_malloc(obj_size(i));
+        for (int i = 0; i < OBJS_PER_MSG; i++)
+            my_free(objs[i]);
+    }
+    return bench_now_ns() - start;
+}
+
+static uint64_t run_arena(void) {
+    Arena_t arena;
+    size_t total = 0;
+    for (int i = 0; i < OBJS_PER_MSG; i++)
+        total += obj_size(i) + 16;
+    arena_init(&arena, total);
+
+    uint64_t start = bench_now_ns();
+    for (int m = 0; m < MESSAGES; m++) {
+        for (int i = 0; i < OBJS_PER_MSG; i++)
+            arena_alloc(&arena, obj_size(i));
+        arena_reset(&arena);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+    arena_destroy(&arena);
+    return elapsed;
+}
+
+int main(void) {
+    void *live[LIVE_OBJS];
+
+    bench_init();
+    init_allocator();
+    populate_heap(live);
+
+    uint64_t t_free = run_malloc_free();
+    uint64_t t_arena = run_arena();
+    uint32_t per_msg_free = (uint32_t)(t_free / MESSAGES);
+    uint32_t per_msg_arena = (uint32_t)(t_arena / MESSAGES);
+
+    kprintf("arena: %d messages x %d objects\n", MESSAGES, OBJS_PER_MSG);
+    kprintf("  my_malloc/my_free : %u ns/message\n", per_msg_free);
+    kprintf("  arena_alloc/reset : %u ns/message\n", per_msg_arena);
+    kprintf("  speedup           : %ux\n",
+            per_msg_arena ? per_msg_free / per_msg_arena : 0);
+    return 0;
+}
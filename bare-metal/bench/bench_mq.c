@@ -0,0 +1,120 @@
+/*
+ * bench_mq.c - publisher-side cost of mq_publish, sync vs async
+ *
+ * Two subscribers each burn a fixed amount of work per message. In sync
+ * mode the publisher pays for that work; in async mode it only pays for
+ * queueing, and the dispatch queue is drained outside the timed region.
+ *
+ * The second part has one subscriber per device, each interested only in
+ * its own device's messages: every callback checking the ID itself vs a
+ * declarative filter per subscriber.
+ */
+
+#include "bench.h"
+#include "mq.h"
+#include "mem.h"
+#include "scheduler.h"
+
+#define DISPATCH_CAPACITY 64
+#define PUBLISHES         (256 * 1024)
+#define DEVICES           32
+
+static volatile uint32_t sink;
+static uint32_t work_per_message;
+
+static void subscriber(void *message, void *context) {
+    (void)context;
+    for (uint32_t i = 0; i < work_per_message; i++)
+        sink += (uint32_t)(uintptr_t)message + i;
+}
+
+static uint64_t run(MQ_t *topic) {
+    uint64_t timed = 0;
+    for (uint32_t n = 0; n < PUBLISHES; n += DISPATCH_CAPACITY) {
+        uint64_t start = bench_now_ns();
+        for (uintptr_t i = 0; i < DISPATCH_CAPACITY; i++)
+            mq_publish(topic, (void *)i);
+        timed += bench_now_ns() - start;
+        mq_dispatch_pending();
+    }
+    return timed;
+}
+
+typedef struct {
+    uint16_t device;
+    uint16_t kind;
+    uint32_t value;
+} DeviceMsg_t;
+
+static void device_subscriber(void *message, void *context) {
+    const DeviceMsg_t *m = (const DeviceMsg_t *)message;
+    if (m->device != (uint16_t)(uintptr_t)context)
+        return;
+    sink += m->value;
+}
+
+static uint64_t run_devices(MQ_t *topic) {
+    DeviceMsg_t msgs[DEVICES];
+    for (uint16_t d = 0; d < DEVICES; d++)
+        msgs[d] = (DeviceMsg_t){ d, 0, d };
+    uint64_t start = bench_now_ns();
+    for (uint32_t n = 0; n < PUBLISHES; n++)
+        mq_publish(topic, &msgs[(n * 7) % DEVICES]);
+    return bench_now_ns() - start;
+}
+
+static void bench_filters(void) {
+    MQ_t in_callback, filtered;
+    mq_init(&in_callback);
+    mq_init(&filtered);
+    for (uintptr_t d = 0; d < DEVICES; d++) {
+        MQFilter_t f = { offsetof(DeviceMsg_t, device), 2, 0xFFFF, (uint32_t)d };
+        mq_subscribe(&in_callback, device_subscriber, (void *)d);
+        mq_subscribe_filtered(&filtered, device_subscriber, (void *)d, &f);
+    }
+    /* Best of several runs: both variants are short enough to be noisy */
+    uint64_t cb_best = ~0ull, f_best = ~0ull;
+    for (int run = 0; run < 5; run++) {
+        uint64_t t = run_devices(&in_callback);
+        if (t < cb_best)
+            cb_best = t;
+        t = run_devices(&filtered);
+        if (t < f_best)
+            f_best = t;
+    }
+    uint32_t cb_ns = (uint32_t)(cb_best / PUBLISHES);
+    uint32_t f_ns = (uint32_t)(f_best / PUBLISHES);
+    kprintf("device filter (%u subscribers, 1 match per message)\n",
+            (uint32_t)DEVICES);
+    kprintf("  check in callback %u ns/publish, mq filter %u ns/publish\n",
+            cb_ns, f_ns);
+    mq_destroy(&in_callback);
+    mq_destroy(&filtered);
+}
+
+int main(void) {
+    static const uint32_t work[] = { 0, 100, 1000 };
+
+    bench_init();
+    init_allocator();
+    scheduler_init();
+    mq_dispatcher_init(DISPATCH_CAPACITY);
+
+    MQ_t topic;
+    mq_init(&topic);
+    mq_subscribe(&topic, subscriber, NULL);
+    mq_subscribe(&topic, subscriber, NULL);
+
+    kprintf("mq_publish cost (%u publishes, 2 subscribers)\n", (uint32_t)PUBLISHES);
+    for (size_t i = 0; i < sizeof(work) / sizeof(work[0]); i++) {
+        work_per_message = work[i];
+        mq_set_mode(&topic, MQ_SYNC);
+        uint32_t sync_ns = (uint32_t)(run(&topic) / PUBLISHES);
+        mq_set_mode(&topic, MQ_ASYNC);
+        uint32_t async_ns = (uint32_t)(run(&topic) / PUBLISHES);
+        kprintf("  work=%u: sync %u ns/publish, async %u ns/publish\n",
+                work[i], sync_ns, async_ns);
+    }
+    bench_filters();
+    return 0;
+}
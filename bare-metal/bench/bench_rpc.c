@@ -0,0 +1,136 @@
+/*
+ * bench_rpc.c - request/response round trip: two IPC_t queues vs ipc_call
+ *
+ * A client at priority 1 calls an echo server at priority 3. The queue
+ * pattern sends a correlated request on one queue and blocks on a second
+ * queue for the reply; ipc_call hands the request straight to the waiting
+ * server and blocks once. Tasks run as host coroutines (tests/host_tasks.c)
+ * on the real scheduler, so context switches are real and counted.
+ *
+ * The second round adds a yielding CPU-bound task at priority 2. Without
+ * donation it starves the priority-3 server and the client's worst-case
+ * call time includes the whole busy period.
+ */
+
+#include "bench.h"
+#include "host_tasks.h"
+#include "ipc.h"
+#include "mem.h"
+#include "scheduler.h"
+
+#define CALLS      (256 * 1024)
+#define HOG_YIELDS (1024 * 1024)
+
+typedef struct {
+    uint32_t id;
+    uint32_t value;
+} Request_t;
+
+static IPC_t requests;
+static IPC_t replies;
+static IPCEndpoint_t endpoint;
+static uint32_t mismatches;
+static uint64_t worst_ns;
+
+static void record_call(uint64_t start) {
+    uint64_t ns = bench_now_ns() - start;
+    if (ns > worst_ns)
+        worst_ns = ns;
+}
+
+/* --- two-queue pattern --- */
+
+static void queue_server(void) {
+    void *msg;
+    for (uint32_t i = 0; i < CALLS; i++) {
+        ipc_receive(&requests, &msg);
+        ((Request_t *)msg)->value++;
+        ipc_send(&replies, msg);
+    }
+}
+
+static void queue_client(void) {
+    Request_t req;
+    void *msg;
+    for (uint32_t i = 0; i < CALLS; i++) {
+        req.id = i;
+        req.value = i;
+        uint64_t start = bench_now_ns();
+        ipc_send(&requests, &req);
+        ipc_receive(&replies, &msg);
+        record_call(start);
+        if (((Request_t *)msg)->id != i || ((Request_t *)msg)->value != i + 1)
+            mismatches++;
+    }
+}
+
+/* --- call/reply --- */
+
+static void rpc_server(void) {
+    void *msg;
+    ipc_reply_wait(&endpoint, NULL, &msg);
+    for (uint32_t i = 1; i < CALLS; i++) {
+        ((Request_t *)msg)->value++;
+        ipc_reply_wait(&endpoint, msg, &msg);
+    }
+    ((Request_t *)msg)->value++;
+    /* Deliver the last reply; nobody calls again */
+    ipc_reply_wait(&endpoint, msg, &msg);
+}
+
+static void rpc_client(void) {
+    Request_t req;
+    void *msg;
+    for (uint32_t i = 0; i < CALLS; i++) {
+        req.id = i;
+        req.value = i;
+        uint64_t start = bench_now_ns();
+        ipc_call(&endpoint, &req, &msg);
+        record_call(start);
+        if (((Request_t *)msg)->id != i || ((Request_t *)msg)->value != i + 1)
+            mismatches++;
+    }
+}
+
+/* Medium-priority load that never blocks */
+static void hog(void) {
+    for (uint32_t i = 0; i < HOG_YIELDS; i++)
+        task_yield();
+}
+
+static void run(const char *name, TaskFunction_t server, TaskFunction_t client,
+                bool with_hog) {
+    host_tasks_init();
+    ipc_init(&requests, 1);
+    ipc_init(&replies, 1);
+    ipc_endpoint_init(&endpoint);
+    mismatches = 0;
+    worst_ns = 0;
+    /* Let the server reach its first wait before any client runs */
+    host_task_create(server, 3);
+    host_tasks_run();
+    host_task_create(client, 1);
+    if (with_hog)
+        host_task_create(hog, 2);
+    uint64_t start = bench_now_ns();
+    host_tasks_run();
+    uint64_t ns = bench_now_ns() - start;
+    kprintf("  %s: %u ns/call, worst %u us, %u switches, %u mismatches\n", name,
+            (uint32_t)(ns / CALLS), (uint32_t)(worst_ns / 1000),
+            host_context_switches, mismatches);
+    ipc_destroy(&requests);
+    ipc_destroy(&replies);
+}
+
+int main(void) {
+    bench_init();
+    init_allocator();
+
+    kprintf("rpc round trip (%u calls)\n", (uint32_t)CALLS);
+    run("two queues    ", queue_server, queue_client, false);
+    run("ipc_call/reply", rpc_server, rpc_client, false);
+    kprintf("with a busy priority-2 task (%u yields)\n", (uint32_t)HOG_YIELDS);
+    run("two queues    ", queue_server, queue_client, true);
+    run("ipc_call/reply", rpc_server, rpc_client, true);
+    return 0;
+}
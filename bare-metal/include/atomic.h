@@ -0,0 +1,162 @@
+#ifndef RTOS_ATOMIC_H
+#define RTOS_ATOMIC_H
+
+#include "types.h"
+
+/*
+ * Word-sized atomics. On ARMv7 these are LDREX/STREX retry loops bracketed
+ * by DMB, so every read-modify-write is a full barrier. Host builds (unit
+ * tests, benchmarks) map onto the GCC __atomic builtins.
+ */
+
+#if defined(__arm__)
+
+static inline void smp_mb(void) {
+    __asm__ volatile("dmb ish" ::: "memory");
+}
+
+static inline void cpu_relax(void) {
+    __asm__ volatile("yield" ::: "memory");
+}
+
+static inline uint32_t atomic_add_return(volatile uint32_t *p, uint32_t v) {
+    uint32_t result, fail;
+    smp_mb();
+    __asm__ volatile(
+        "1: ldrex   %0, [%2]\n"
+        "   add     %0, %0, %3\n"
+        "   strex   %1, %0, [%2]\n"
+        "   teq     %1, #0\n"
+        "   bne     1b\n"
+        : "=&r"(result), "=&r"(fail)
+        : "r"(p), "r"(v)
+        : "cc", "memory");
+    smp_mb();
+    return result;
+}
+
+static inline uint32_t atomic_xchg(volatile uint32_t *p, uint32_t v) {
+    uint32_t old, fail;
+    smp_mb();
+    __asm__ volatile(
+        "1: ldrex   %0, [%2]\n"
+        "   strex   %1, %3, [%2]\n"
+        "   teq     %1, #0\n"
+        "   bne     1b\n"
+        : "=&r"(old), "=&r"(fail)
+        : "r"(p), "r"(v)
+        : "cc", "memory");
+    smp_mb();
+    return old;
+}
+
+/* Returns true and stores desired if *p == expected */
+static inline bool atomic_cmpxchg(volatile uint32_t *p, uint32_t expected,
+                                  uint32_t desired) {
+    uint32_t old, fail;
+    smp_mb();
+    __asm__ volatile(
+        "1: ldrex   %0, [%2]\n"
+        "   teq     %0, %3\n"
+        "   bne     2f\n"
+        "   strex   %1, %4, [%2]\n"
+        "   teq     %1, #0\n"
+        "   bne     1b\n"
+        "   b       3f\n"
+        "2: clrex\n"
+        "3:\n"
+        : "=&r"(old), "=&r"(fail)
+        : "r"(p), "r"(expected), "r"(desired)
+        : "cc", "memory");
+    smp_mb();
+    return old == expected;
+}
+
+/* Plain loads/stores with acquire/release ordering */
+static inline uint32_t atomic_read(const volatile uint32_t *p) {
+    uint32_t v = *p;
+    smp_mb();
+    return v;
+}
+
+static inline void atomic_set(volatile uint32_t *p, uint32_t v) {
+    smp_mb();
+    *p = v;
+}
+
+/* Pointers are one word on AArch32 */
+static inline void *atomic_read_ptr(void *const volatile *p) {
+    return (void *)atomic_read((const volatile uint32_t *)p);
+}
+
+static inline void atomic_set_ptr(void *volatile *p, void *v) {
+    atomic_set((volatile uint32_t *)p, (uint32_t)v);
+}
+
+static inline void *atomic_xchg_ptr(void *volatile *p, void *v) {
+    return (void *)atomic_xchg((volatile uint32_t *)p, (uint32_t)v);
+}
+
+static inline bool atomic_cmpxchg_ptr(void *volatile *p, void *expected,
+                                      void *desired) {
+    return atomic_cmpxchg((volatile uint32_t *)p, (uint32_t)expected,
+                          (uint32_t)desired);
+}
+
+#else /* host */
+
+static inline void smp_mb(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void cpu_relax(void) {
+    __asm__ volatile("" ::: "memory");
+}
+
+static inline uint32_t atomic_read(const volatile uint32_t *p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void atomic_set(volatile uint32_t *p, uint32_t v) {
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t atomic_add_return(volatile uint32_t *p, uint32_t v) {
+    return __atomic_add_fetch(p, v, __ATOMIC_SEQ_CST);
+}
+
+static inline uint32_t atomic_xchg(volatile uint32_t *p, uint32_t v) {
+    return __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST);
+}
+
+static inline bool atomic_cmpxchg(volatile uint32_t *p, uint32_t expected,
+                                  uint32_t desired) {
+    return __atomic_compare_exchange_n(p, &expected, desired, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline void *atomic_read_ptr(void *const volatile *p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static inline void atomic_set_ptr(void *volatile *p, void *v) {
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+static inline void *atomic_xchg_ptr(void *volatile *p, void *v) {
+    return __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST);
+}
+
+static inline bool atomic_cmpxchg_ptr(void *volatile *p, void *expected,
+                                      void *desired) {
+    return __atomic_compare_exchange_n(p, &expected, desired, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+#endif
+
+static inline uint32_t atomic_sub_return(volatile uint32_t *p, uint32_t v) {
+    return atomic_add_return(p, (uint32_t)-v);
+}
+
+#endif /* RTOS_ATOMIC_H */
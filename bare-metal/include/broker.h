@@ -0,0 +1,75 @@
+#ifndef RTOS_BROKER_H
+#define RTOS_BROKER_H
+
+#include "types.h"
+#include "mq.h"
+
+/*
+ * Topic registry for MQ. Topics are created on first use, either by
+ * numeric ID or by name, and live in an open-addressing hash table, so
+ * publishing to a topic is one probe sequence plus the fan-out. Topics
+ * are never removed, which keeps probing free of tombstones.
+ *
+ * Prefix subscriptions ("sensor/" matches "sensor/temp") are resolved
+ * when they are made and whenever a matching named topic is created,
+ * so publishing never scans patterns.
+ *
+ * Creating topics and prefix subscriptions must happen from one context
+ * at a time (typically at start-up). Lookups and publishes take no lock
+ * and may run anywhere: a topic becomes visible only once it is complete.
+ */
+
+#define BROKER_NAME_LEN      32
+#define BROKER_MAX_WILDCARDS 16
+
+typedef struct {
+    uint32_t hash;
+    uint32_t id;                /* numeric topics only */
+    volatile uint32_t used;     /* set last, once the topic is complete */
+    bool named;
+    char name[BROKER_NAME_LEN];
+    MQ_t mq;
+} BrokerTopic_t;
+
+typedef struct {
+    char prefix[BROKER_NAME_LEN];
+    size_t len;
+    MessageCallback_t callback;
+    void *context;
+} BrokerWildcard_t;
+
+typedef struct {
+    BrokerTopic_t *slots;
+    size_t mask;                /* table size - 1, size a power of two */
+    size_t count;
+    size_t max_topics;
+    BrokerWildcard_t wildcards[BROKER_MAX_WILDCARDS];
+    size_t wildcard_count;
+} Broker_t;
+
+int broker_init(Broker_t *b, size_t max_topics);
+void broker_destroy(Broker_t *b);
+
+/*
+ * Find or create a topic; NULL if the registry is full, the name too
+ * long, or a matching prefix subscription could not be added.
+ */
+MQ_t *broker_topic(Broker_t *b, uint32_t id);
+MQ_t *broker_topic_named(Broker_t *b, const char *name);
+
+/* Find only; NULL if the topic does not exist */
+MQ_t *broker_find(Broker_t *b, uint32_t id);
+MQ_t *broker_find_named(Broker_t *b, const char *name);
+
+/* Publish to an existing topic; -1 if it does not exist */
+int broker_publish(Broker_t *b, uint32_t id, void *message);
+int broker_publish_named(Broker_t *b, const char *name, void *message);
+
+/*
+ * Subscribe to every named topic starting with prefix, now and later.
+ * -1 if any existing topic could not be subscribed; none then are.
+ */
+int broker_subscribe_prefix(Broker_t *b, const char *prefix,
+                            MessageCallback_t callback, void *context);
+
+#endif /* RTOS_BROKER_H */
@@ -0,0 +1,41 @@
+#ifndef RTOS_COND_H
+#define RTOS_COND_H
+
+#include "kernel.h"
+#include "semaphore.h"
+#include "spinlock.h"
+
+/*
+ * Condition variables. The mutex is a Semaphore_t initialised to 1, and
+ * every waiter on one condition variable must use the same mutex.
+ * cond_wait queues the caller and releases the mutex in one step with
+ * respect to cond_signal, so a signal sent after the release is never
+ * lost. Waiters are woken highest priority first.
+ *
+ * If the mutex is still held when a waiter is signalled, the waiter moves
+ * straight onto the mutex's wait queue instead of being woken, so it runs
+ * only once it owns the mutex and does not wake just to block again.
+ */
+typedef struct CondWaiter {
+    TCB_t *task;
+    struct CondWaiter *next;
+    uint8_t state;
+} CondWaiter_t;
+
+typedef struct {
+    CondWaiter_t *waiting;      /* by priority, FIFO within a level */
+    Semaphore_t *mutex;         /* mutex of the current waiters */
+    spinlock_t lock;
+} CondVar_t;
+
+void cond_init(CondVar_t *cv);
+/*
+ * Called with mutex held; returns with it held again. Returns -1 if the
+ * task was resumed without being signalled (callers re-check their
+ * predicate in a loop anyway).
+ */
+int cond_wait(CondVar_t *cv, Semaphore_t *mutex);
+void cond_signal(CondVar_t *cv);
+void cond_broadcast(CondVar_t *cv);
+
+#endif /* RTOS_COND_H */
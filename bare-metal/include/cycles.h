@@ -0,0 +1,55 @@
+#ifndef RTOS_CYCLES_H
+#define RTOS_CYCLES_H
+
+#include "types.h"
+
+/*
+ * Free-running cycle counter for latency measurement. On bare-metal
+ * Cortex-A7 this is the PMU cycle counter (PMCCNTR); host builds use the
+ * TSC on x86 and a nanosecond clock elsewhere. Differences of two reads
+ * are valid across a single 32-bit wrap.
+ */
+
+#if defined(__arm__) && !__STDC_HOSTED__
+
+static inline void cycles_init(void) {
+    uint32_t pmcr;
+    __asm__ volatile("mrc p15, 0, %0, c9, c12, 0" : "=r"(pmcr));
+    pmcr |= (1 << 0) | (1 << 2);    /* E: enable counters, C: reset PMCCNTR */
+    pmcr &= ~(1u << 3);             /* D: count every cycle, not every 64th */
+    __asm__ volatile("mcr p15, 0, %0, c9, c12, 0" : : "r"(pmcr));
+    /* PMCNTENSET bit 31: enable the cycle counter */
+    __asm__ volatile("mcr p15, 0, %0, c9, c12, 1" : : "r"(1u << 31));
+}
+
+static inline uint32_t cycles_read(void) {
+    uint32_t v;
+    __asm__ volatile("mrc p15, 0, %0, c9, c13, 0" : "=r"(v));
+    return v;
+}
+
+#elif defined(__x86_64__) || defined(__i386__)
+
+static inline void cycles_init(void) {
+}
+
+static inline uint32_t cycles_read(void) {
+    return (uint32_t)__builtin_ia32_rdtsc();
+}
+
+#else
+
+#include <time.h>
+
+static inline void cycles_init(void) {
+}
+
+static inline uint32_t cycles_read(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec);
+}
+
+#endif
+
+#endif /* RTOS_CYCLES_H */
@@ -0,0 +1,25 @@
+#ifndef RTOS_FUTEX_H
+#define RTOS_FUTEX_H
+
+#include "kernel.h"
+
+/*
+ * Wait-on-address. A synchronization object built from atomics on a
+ * 32-bit word (lock, once flag, latch, barrier) keeps its fast path in
+ * user code and calls in here only when a task has to sleep or be woken.
+ * Waiters are kept in a small hash table of queues keyed by address, so
+ * the object itself stores nothing but its word.
+ *
+ * futex_wait checks *addr == expected and queues the caller under the
+ * same bucket lock that futex_wake takes, so a wake issued after the
+ * word changed cannot slip in between the check and the sleep.
+ */
+#define FUTEX_HASH_BITS 4
+#define FUTEX_BUCKETS   (1u << FUTEX_HASH_BITS)
+
+/* Returns 0 when woken, -1 if *addr != expected or resumed without a wake */
+int futex_wait(volatile uint32_t *addr, uint32_t expected);
+/* Wake up to n tasks waiting on addr, highest priority first; ISR-safe */
+uint32_t futex_wake(volatile uint32_t *addr, uint32_t n);
+
+#endif /* RTOS_FUTEX_H */
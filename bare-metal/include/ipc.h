@@ -9,19 +9,145 @@ typedef struct WaitingNode {
     struct WaitingNode *next;
 } WaitingNode;
 
-typedef struct {
+typedef enum {
+    IPC_WATERMARK_NONE,
+    IPC_WATERMARK_HIGH,     /* depth rose to the high mark */
+    IPC_WATERMARK_LOW       /* depth fell back to the low mark */
+} IPCWatermark_t;
+
+struct IPC;
+
+/*
+ * Runs in the sender's or receiver's context with IRQs masked, so events
+ * arrive in the order the crossings happened. Keep it short; it may use
+ * the non-blocking calls but must not block.
+ */
+typedef void (*IPCWatermarkFn_t)(struct IPC *q, IPCWatermark_t event, void *context);
+
+typedef struct IPC {
     void **buffer;
     size_t capacity;
     size_t head;
     size_t tail;
     size_t count;
+    size_t peak;            /* highest count since init */
     WaitingNode *waitingConsumers;
     WaitingNode *waitingProducers;
+
+    /* Watermarks: HIGH once count reaches high_mark, LOW once it falls to low_mark */
+    size_t high_mark;
+    size_t low_mark;
+    bool above_high;
+    IPCWatermarkFn_t on_watermark;
+    void *watermark_ctx;
 } IPC_t;
 
+/*
+ * Copy-by-value variant: fixed-size payloads are stored inline in the ring
+ * and copied in on send and out on receive, so messages need no heap
+ * allocation. Slots are padded to a word boundary.
+ */
+typedef struct {
+    uint8_t *buffer;
+    size_t item_size;
+    size_t stride;
+    size_t capacity;
+    size_t head;
+    size_t tail;
+    size_t count;
+    WaitingNode *waitingConsumers;
+    WaitingNode *waitingProducers;
+} IPCCopy_t;
+
+/*
+ * Priority variant: each send carries a priority (0 = highest) and receive
+ * returns the highest-priority message, FIFO within a level. Nodes come
+ * from a pool sized at init; a bitmap of non-empty levels makes both send
+ * and receive O(1).
+ */
+#define IPC_PRIO_LEVELS 8
+
+typedef struct IPCPrioNode {
+    void *message;
+    struct IPCPrioNode *next;
+} IPCPrioNode;
+
+typedef struct {
+    IPCPrioNode *nodes;
+    IPCPrioNode *free;
+    IPCPrioNode *head[IPC_PRIO_LEVELS];
+    IPCPrioNode *tail[IPC_PRIO_LEVELS];
+    uint32_t ready;         /* bit p set while level p is non-empty */
+    size_t capacity;
+    size_t count;
+    WaitingNode *waitingConsumers;
+    WaitingNode *waitingProducers;
+} IPCPrio_t;
+
+/*
+ * Synchronous call/reply endpoint. The client blocks once in ipc_call
+ * until the server replies; request and reply travel in the TCBs' message
+ * fields, so nothing is queued or allocated per call. While a call is
+ * pending the server runs at the caller's priority if that is higher.
+ */
+typedef struct {
+    TCB_t *server;          /* task serving the endpoint, NULL until it waits */
+    bool server_waiting;    /* server is blocked in ipc_reply_wait */
+    TCB_t *client;          /* caller being served */
+    TCB_t *callers;         /* callers not yet accepted, by priority */
+} IPCEndpoint_t;
+
 int ipc_init(IPC_t *q, size_t capacity);
 void ipc_destroy(IPC_t *q);
+/*
+ * Block while the queue is full (or empty). A woken task checks again,
+ * since another may have taken the slot first. -1 only if resumed
+ * without being woken.
+ */
 int ipc_send(IPC_t *q, void *message);
 int ipc_receive(IPC_t *q, void **message);
+/* Non-blocking (ISR-safe): return -1 instead of waiting */
+int ipc_try_send(IPC_t *q, void *message);
+int ipc_try_receive(IPC_t *q, void **message);
+/*
+ * Never blocks: if the queue is full the oldest message is removed to make
+ * room and returned in *evicted (NULL otherwise). Returns 1 if a message
+ * was evicted, 0 if not.
+ */
+int ipc_send_overwrite(IPC_t *q, void *message, void **evicted);
+/* Requires low < high <= capacity; fn NULL disables, marks ignored */
+int ipc_set_watermarks(IPC_t *q, size_t high, size_t low,
+                       IPCWatermarkFn_t fn, void *context);
+
+/*
+ * Batched variants: each critical section moves as many pointers as fit
+ * and wakes the matching number of waiters once. send_many blocks while
+ * the queue is full until all n are sent; receive_many blocks only while
+ * the queue is empty and returns how many it took (at most max), or 0
+ * if resumed without being woken.
+ */
+int ipc_send_many(IPC_t *q, void *const *messages, size_t n);
+int ipc_receive_many(IPC_t *q, void **messages, size_t max);
+
+int ipc_copy_init(IPCCopy_t *q, size_t capacity, size_t item_size);
+void ipc_copy_destroy(IPCCopy_t *q);
+/* Block while full (or empty); -1 only if resumed without being woken */
+int ipc_copy_send(IPCCopy_t *q, const void *item);
+int ipc_copy_receive(IPCCopy_t *q, void *item);
+
+int ipc_prio_init(IPCPrio_t *q, size_t capacity);
+void ipc_prio_destroy(IPCPrio_t *q);
+/*
+ * Block while full (or empty); -1 for a bad priority or if resumed
+ * without being woken.
+ */
+int ipc_prio_send(IPCPrio_t *q, void *message, uint8_t priority);
+int ipc_prio_receive(IPCPrio_t *q, void **message);
+
+void ipc_endpoint_init(IPCEndpoint_t *ep);
+/* Client: send request and block until the server's reply arrives */
+int ipc_call(IPCEndpoint_t *ep, void *request, void **reply);
+/* Server: reply to the current caller (if any) and wait for the next request */
+int ipc_reply_wait(IPCEndpoint_t *ep, void *reply, void **request);
 
 #endif /* RTOS_IPC_H */
@@ -5,10 +5,13 @@
 
 /*
  * On bare-metal ARM these use inline asm (cpsid i / msr cpsr_c).
- * For host unit tests, they are no-ops provided as weak symbols.
+ * For host unit tests, they are weak no-ops in tests/host_irq.c.
  */
 uint32_t irq_disable(void);
 void irq_restore(uint32_t flags);
 void irq_enable(void);
 
+/* Index of the executing core (MPIDR affinity level 0) */
+uint32_t cpu_id(void);
+
 #endif /* RTOS_IRQ_H */
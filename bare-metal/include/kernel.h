@@ -3,6 +3,7 @@
 
 #include "types.h"
 
+#define MAX_CPUS        4
 #define MAX_PRIORITIES  8
 #define MAX_TASKS       16
 #define TASK_STACK_SIZE 4096
@@ -22,6 +23,7 @@ typedef struct TCB {
     uint32_t    *sp;
     struct TCB  *next;
     uint8_t     priority;
+    uint8_t     base_priority;  /* priority without donation */
     TaskState_t state;
     uint32_t    delay_ticks;
     uint32_t    time_slice;
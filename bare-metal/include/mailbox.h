@@ -0,0 +1,44 @@
+#ifndef RTOS_MAILBOX_H
+#define RTOS_MAILBOX_H
+
+#include "types.h"
+#include "kernel.h"
+#include "spinlock.h"
+
+/*
+ * Single-slot "latest value" mailbox. Each post overwrites the slot and
+ * never blocks. The slot is guarded by a sequence lock: the count is odd
+ * while a post is copying, and a reader that sees it change retries, so
+ * readers copy multi-word values without masking IRQs and never see a
+ * torn value. Posting takes a spinlock with IRQs masked only to serialize
+ * producers.
+ */
+
+typedef struct {
+    volatile uint32_t seq;  /* 2 * posts so far; odd while posting */
+    uint8_t *data;
+    size_t size;
+    spinlock_t lock;        /* producers and the blocking slow path */
+    TCB_t *waiting;         /* readers blocked for a new value */
+} Mailbox_t;
+
+int mailbox_init(Mailbox_t *mb, size_t size);
+void mailbox_destroy(Mailbox_t *mb);
+
+/* Overwrite the value and wake every blocked reader (ISR-safe) */
+void mailbox_post(Mailbox_t *mb, const void *value);
+
+/*
+ * Copy the latest value and return its version. Before the first post
+ * the version is 0 and the value is all zero bytes.
+ */
+uint32_t mailbox_peek(Mailbox_t *mb, void *out);
+
+/*
+ * Copy a value newer than *version, blocking until one is posted, and
+ * update *version. Start with *version = 0. -1 if resumed without a
+ * post.
+ */
+int mailbox_read_new(Mailbox_t *mb, void *out, uint32_t *version);
+
+#endif /* RTOS_MAILBOX_H */
@@ -3,9 +3,74 @@
 
 #include "types.h"
 
+/* Cortex-A7 L1/L2 line size; also the unit for avoiding false sharing */
+#define CACHE_LINE_SIZE 64
+
+/* my_malloc_flags flags */
+#define MEM_CACHE_ALIGNED 0x1   /* start on, and fill whole, cache lines */
+
+/* Heap statistics snapshot (see mem_get_stats) */
+typedef struct {
+    size_t heap_size;       /* total bytes reserved for the heap */
+    size_t heap_used;       /* high-water mark of heap_ptr (bytes carved so far) */
+    size_t free_bytes;      /* bytes on the free list */
+    size_t largest_free;    /* largest single free block, in bytes */
+    size_t free_blocks;     /* number of blocks on the free list */
+    size_t cached_bytes;    /* bytes parked in per-core magazines */
+    size_t cached_blocks;   /* blocks parked in per-core magazines */
+    size_t used_blocks;     /* live allocations */
+    uint32_t alloc_count;   /* successful my_malloc calls */
+    uint32_t free_count;    /* my_free calls with a non-NULL pointer */
+    uint32_t failed_allocs; /* my_malloc calls that returned NULL */
+    uint32_t cache_hits;    /* allocations served by a magazine, no heap lock */
+} MemStats_t;
+
+/*
+ * Arena: bump-pointer region carved from the heap in one my_malloc call.
+ * Objects are never freed individually; arena_reset() releases them all
+ * in O(1), and arena_mark()/arena_rewind() give nested scopes.
+ */
+typedef struct {
+    char *base;
+    size_t size;
+    size_t used;
+} Arena_t;
+
+/*
+ * my_malloc/my_free are safe to call from tasks, IRQ handlers and any core:
+ * small blocks go through per-core magazines with local IRQs masked, and
+ * the shared free list is protected by an IRQ-saving spinlock.
+ */
 void init_allocator(void);
 void *my_malloc(size_t nbytes);
 void my_free(void *ap);
 void *my_realloc(void *ptr, size_t size);
+/* alignment must be a power of two; blocks are released with my_free */
+void *my_memalign(size_t alignment, size_t nbytes);
+void *my_malloc_flags(size_t nbytes, uint32_t flags);
+void mem_get_stats(MemStats_t *stats);
+/* Return the calling core's magazine blocks to the shared heap */
+void mem_flush_cache(void);
+
+int arena_init(Arena_t *a, size_t size);
+void arena_destroy(Arena_t *a);
+void *arena_alloc(Arena_t *a, size_t nbytes);
+size_t arena_mark(const Arena_t *a);
+void arena_rewind(Arena_t *a, size_t mark);
+void arena_reset(Arena_t *a);
+
+#ifdef MEM_CALLSITE_STATS
+/* Per-call-site allocation histogram, keyed by the caller's return address */
+#define MEM_CALLSITE_SLOTS 32
+
+typedef struct {
+    void *site;
+    uint32_t allocs;
+    uint32_t frees;
+    size_t bytes;           /* bytes currently held by this site */
+} MemCallsite_t;
+
+size_t mem_get_callsites(MemCallsite_t *out, size_t max);
+#endif
 
 #endif /* RTOS_MEM_H */
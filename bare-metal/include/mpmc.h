@@ -0,0 +1,55 @@
+#ifndef RTOS_MPMC_H
+#define RTOS_MPMC_H
+
+#include "types.h"
+#include "kernel.h"
+#include "mem.h"
+#include "spinlock.h"
+
+/*
+ * Bounded multi-producer/multi-consumer queue (Vyukov sequence-numbered
+ * cells). Producers and consumers claim slots with a compare-and-swap on
+ * their own position counter; each cell's sequence number says whether it
+ * is free for the claiming side. Nothing masks IRQs or takes a lock unless
+ * a caller has to block. Capacity must be a power of two.
+ */
+
+typedef struct {
+    volatile uint32_t seq;
+    uintptr_t data;
+} MpmcCell_t;
+
+typedef struct {
+    volatile uint32_t enqueue_pos __attribute__((aligned(CACHE_LINE_SIZE)));
+    volatile uint32_t dequeue_pos __attribute__((aligned(CACHE_LINE_SIZE)));
+
+    /* Slow path: blocked tasks, linked through TCB next */
+    spinlock_t lock __attribute__((aligned(CACHE_LINE_SIZE)));
+    volatile uint32_t producers_waiting;
+    volatile uint32_t consumers_waiting;
+    TCB_t *waitingProducers;
+    TCB_t *waitingConsumers;
+
+    /* Read-only after init */
+    MpmcCell_t *cells __attribute__((aligned(CACHE_LINE_SIZE)));
+    uint32_t mask;
+} MPMC_t;
+
+int mpmc_init(MPMC_t *q, size_t capacity);
+void mpmc_destroy(MPMC_t *q);
+
+/* Never block (ISR-safe): 0 on success, -1 if full/empty */
+int mpmc_try_push(MPMC_t *q, uintptr_t item);
+int mpmc_try_pop(MPMC_t *q, uintptr_t *item);
+
+/*
+ * Task context: block while full/empty, retrying if a woken task finds
+ * the cell already taken. -1 only if resumed without being woken.
+ */
+int mpmc_push(MPMC_t *q, uintptr_t item);
+int mpmc_pop(MPMC_t *q, uintptr_t *item);
+
+/* Approximate while other cores are active */
+size_t mpmc_count(const MPMC_t *q);
+
+#endif /* RTOS_MPMC_H */
@@ -2,22 +2,153 @@
 #define RTOS_MQ_H
 
 #include "types.h"
+#include "spinlock.h"
+#include "msgbuf.h"
+#include "ipc.h"
 
 typedef void (*MessageCallback_t)(void *message, void *context);
 
-typedef struct CallbackNode {
+typedef struct {
     MessageCallback_t callback;
     void *context;
-    struct CallbackNode *next;
-} CallbackNode;
+} Subscriber_t;
+
+/*
+ * Content filter: the subscriber is called only if the size-byte field
+ * (1, 2 or 4, native endian) at offset in the message satisfies
+ * (field & mask) == value. On a MsgBuf_t topic (mq_set_msgbuf) the
+ * offset is into the payload, mb->data, not the MsgBuf_t header. A mask
+ * of 0 matches every message. Filters are evaluated for the whole
+ * snapshot before any callback runs, so a message on a topic with
+ * filtered subscribers must be at least offset + size bytes long for
+ * each of them.
+ */
+typedef struct {
+    uint16_t offset;
+    uint8_t size;
+    uint32_t mask;
+    uint32_t value;
+} MQFilter_t;
+
+/*
+ * Immutable snapshot of a topic's subscribers. Subscribe and unsubscribe
+ * build a new snapshot and swap it in, so mq_publish walks a contiguous
+ * array without taking a lock, and a callback may (un)subscribe while a
+ * publish is iterating. A replaced snapshot is retired and freed by a
+ * later update (or mq_reclaim) once no publish is walking it, however
+ * busy the topic stays.
+ */
+typedef struct SubscriberSet {
+    size_t count;
+    volatile uint32_t users;            /* publishes walking this snapshot */
+    size_t filtered;                    /* entries with a non-zero mask */
+    struct SubscriberSet *next_retired;
+    MQFilter_t *filters;                /* parallel to entries, same block */
+    Subscriber_t entries[];
+} SubscriberSet_t;
+
+/*
+ * MQ_SYNC runs every callback inside mq_publish. MQ_ASYNC only queues
+ * the message (O(1), ISR-safe) and the dispatcher task runs the callbacks
+ * later at its own priority, so the message must stay valid until then.
+ * On a MsgBuf_t topic publish takes that reference itself and the
+ * dispatcher drops it after delivery.
+ */
+typedef enum {
+    MQ_SYNC,
+    MQ_ASYNC
+} MQMode_t;
 
 typedef struct {
-    CallbackNode *subscribers;
+    SubscriberSet_t *volatile subscribers;  /* NULL when there are none */
+    MQMode_t mode;
+    volatile uint32_t pinning;              /* publishes still taking a snapshot */
+    SubscriberSet_t *retired;
+    spinlock_t update_lock;                 /* serializes subscribe/unsubscribe */
+    MsgBuf_t *retained;                     /* last retained message or NULL */
+    bool msgbuf;                            /* every message is a MsgBuf_t */
 } MQ_t;
 
 void mq_init(MQ_t *queue);
+/* Frees all snapshots; no publish may be in flight */
+void mq_destroy(MQ_t *queue);
+void mq_set_mode(MQ_t *queue, MQMode_t mode);
+/*
+ * Declare that every message published on the topic is a MsgBuf_t.
+ * Filters then read the payload, and an async publish or a subscriber
+ * queue holds its own reference while the message waits there. Set it
+ * before subscribing or publishing.
+ */
+void mq_set_msgbuf(MQ_t *queue, bool msgbuf);
 int mq_subscribe(MQ_t *queue, MessageCallback_t callback, void *context);
+/* filter may be NULL (match all); returns -1 for a malformed filter */
+int mq_subscribe_filtered(MQ_t *queue, MessageCallback_t callback,
+                          void *context, const MQFilter_t *filter);
 int mq_unsubscribe(MQ_t *queue, MessageCallback_t callback, void *context);
-void mq_publish(MQ_t *queue, void *message);
+/* Returns -1 if the topic is async and the dispatch queue is full */
+int mq_publish(MQ_t *queue, void *message);
+/*
+ * Publish a MsgBuf_t and keep a reference to it as the topic's retained
+ * value, replacing (and releasing) the previous one. Every later
+ * mq_subscribe on the topic gets the retained buffer delivered to the
+ * new callback before it returns, so a restarted task sees current state
+ * without asking the producer. The callback must retain the buffer if it
+ * keeps it. A publish racing with the subscribe may arrive first.
+ * Returns -1 unless the topic is a MsgBuf_t topic.
+ */
+int mq_publish_retained(MQ_t *queue, MsgBuf_t *mb);
+/* Drop the retained value; later subscribers get nothing on subscribe */
+void mq_clear_retained(MQ_t *queue);
+/* Free the retired snapshots no publish is walking */
+void mq_reclaim(MQ_t *queue);
+
+/*
+ * Queued subscriber: instead of running a callback in the publisher's
+ * context, each message is put on the subscriber's own bounded IPC_t and
+ * its task drains it with mq_queue_receive. The policy decides what a
+ * publish does when that queue is full:
+ *   MQ_DROP_NEWEST  discard the message being published
+ *   MQ_DROP_OLDEST  discard the oldest queued message to make room
+ *   MQ_BLOCK        block the publisher until there is room (tasks only)
+ * Dropped messages are counted in dropped. The publisher keeps its own
+ * reference either way: on a MsgBuf_t topic the queue retains each
+ * message it holds and releases it if it is dropped or discarded, and
+ * mq_queue_receive passes that reference on to the receiver.
+ */
+typedef enum {
+    MQ_DROP_NEWEST,
+    MQ_DROP_OLDEST,
+    MQ_BLOCK
+} MQOverflow_t;
+
+typedef struct {
+    IPC_t ipc;
+    MQOverflow_t policy;
+    volatile uint32_t dropped;
+    volatile uint32_t closing;  /* set by mq_unsubscribe_queue */
+    bool msgbuf;                /* messages hold a MsgBuf_t reference */
+} MQSubQueue_t;
+
+/* filter may be NULL; the queue is allocated with the given capacity */
+int mq_subscribe_queue(MQ_t *queue, MQSubQueue_t *sq, size_t capacity,
+                       MQOverflow_t policy, const MQFilter_t *filter);
+/*
+ * Unsubscribes and frees the queue; messages still in it are discarded.
+ * Waits for publishes already delivering to it, waking any blocked on
+ * it, so it must not be called from a callback on the same topic.
+ */
+int mq_unsubscribe_queue(MQ_t *queue, MQSubQueue_t *sq);
+/*
+ * Blocks until a message arrives; the receiver releases a MsgBuf_t.
+ * -1 if resumed without one.
+ */
+int mq_queue_receive(MQSubQueue_t *sq, void **message);
+int mq_queue_try_receive(MQSubQueue_t *sq, void **message);
+
+/* Async delivery: one dispatch queue and task shared by all async topics */
+int mq_dispatcher_init(size_t capacity);
+int mq_dispatcher_start(uint8_t priority);
+/* Deliver everything queued so far; returns the number of messages */
+size_t mq_dispatch_pending(void);
 
 #endif /* RTOS_MQ_H */
@@ -0,0 +1,53 @@
+#ifndef RTOS_MSGBUF_H
+#define RTOS_MSGBUF_H
+
+#include "types.h"
+#include "spinlock.h"
+
+/*
+ * Reference-counted message buffers from fixed-size pools. A MsgBuf_t is
+ * passed by pointer through IPC_t or MQ_t: each holder that keeps it past
+ * the call retains it and releases it when done, and the last release
+ * returns it to its pool. Nothing is copied between pipeline stages.
+ *
+ * Each buffer has optional headroom in front of the payload so a stage
+ * can prepend a protocol header in place with msgbuf_push.
+ */
+
+struct MsgPool;
+
+typedef struct MsgBuf {
+    struct MsgPool *pool;       /* pool the buffer returns to */
+    volatile uint32_t refs;
+    struct MsgBuf *next_free;
+    uint8_t *data;              /* first payload byte */
+    size_t len;                 /* payload bytes in use */
+} MsgBuf_t;
+
+typedef struct MsgPool {
+    uint8_t *memory;
+    MsgBuf_t *free;
+    spinlock_t lock;
+    size_t size;                /* payload capacity after headroom */
+    size_t headroom;
+    size_t stride;
+    size_t count;
+    size_t available;
+} MsgPool_t;
+
+int msgpool_init(MsgPool_t *pool, size_t count, size_t size, size_t headroom);
+void msgpool_destroy(MsgPool_t *pool);
+
+/* ISR-safe. Returns a buffer with one reference and an empty payload */
+MsgBuf_t *msgbuf_alloc(MsgPool_t *pool);
+void msgbuf_retain(MsgBuf_t *mb);
+void msgbuf_release(MsgBuf_t *mb);
+
+/* Extend the payload at the tail; returns the new bytes or NULL if full */
+uint8_t *msgbuf_put(MsgBuf_t *mb, size_t n);
+/* Prepend n bytes from the headroom; returns the new start or NULL */
+uint8_t *msgbuf_push(MsgBuf_t *mb, size_t n);
+/* Strip n bytes from the front; returns the new start or NULL */
+uint8_t *msgbuf_pull(MsgBuf_t *mb, size_t n);
+
+#endif /* RTOS_MSGBUF_H */
@@ -0,0 +1,60 @@
+#ifndef RTOS_RWLOCK_H
+#define RTOS_RWLOCK_H
+
+#include "kernel.h"
+#include "spinlock.h"
+
+/*
+ * Reader-writer lock for read-mostly data. The whole lock state is one
+ * word: the reader count, a writer-held bit and a waiters bit. Readers
+ * and writers take and release an uncontended lock with a single
+ * compare-and-swap, so concurrent readers on any core never serialize on
+ * a spinlock. Once any task is queued the waiters bit sends everyone
+ * through the spinlock-protected slow path.
+ *
+ * Writer preference: a new reader blocks while a writer is waiting. On
+ * release the lock is handed straight to the woken task(s), so a woken
+ * task never has to retry. Waiters are queued by priority; a writer goes
+ * before readers of equal or lower priority, and readers of higher
+ * priority than every waiting writer are admitted together.
+ */
+typedef struct {
+    volatile uint32_t state;
+    spinlock_t lock;            /* protects the queues below */
+    TCB_t *readers_waiting;     /* by priority, through tcb->next */
+    TCB_t *writers_waiting;
+    TCB_t *upgrader;            /* reader waiting in rwlock_upgrade */
+} RWLock_t;
+
+#define RWLOCK_WRITER   (1u << 31)
+#define RWLOCK_WAITERS  (1u << 30)
+#define RWLOCK_READERS  (RWLOCK_WAITERS - 1)
+
+void rwlock_init(RWLock_t *rw);
+
+/*
+ * The blocking calls return 0 once the lock is held, or -1 if the task
+ * was resumed without being handed the lock (it then holds nothing).
+ */
+int rwlock_read_lock(RWLock_t *rw);
+int rwlock_write_lock(RWLock_t *rw);
+bool rwlock_try_read_lock(RWLock_t *rw);
+bool rwlock_try_write_lock(RWLock_t *rw);
+void rwlock_read_unlock(RWLock_t *rw);
+void rwlock_write_unlock(RWLock_t *rw);
+
+/*
+ * Turn a held read lock into the write lock, waiting for the other
+ * readers to leave; the upgrader goes ahead of queued writers. Returns 0
+ * holding the write lock, or:
+ *   -1  without blocking, if another task is already upgrading. The
+ *       caller still holds its read lock and must drop it, or the two
+ *       would deadlock.
+ *   -2  if the task was resumed without being handed the lock. Its read
+ *       hold was given up while waiting, so it holds nothing.
+ */
+int rwlock_upgrade(RWLock_t *rw);
+/* Turn the held write lock into a read lock, admitting waiting readers */
+void rwlock_downgrade(RWLock_t *rw);
+
+#endif /* RTOS_RWLOCK_H */
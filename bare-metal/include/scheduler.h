@@ -6,6 +6,7 @@
 void scheduler_init(void);
 void scheduler_add_task(TCB_t *tcb);
 void scheduler_remove_task(TCB_t *tcb);
+void scheduler_set_priority(TCB_t *tcb, uint8_t priority);
 TCB_t *scheduler_select_next(void);
 void scheduler_tick(void);
 TCB_t *scheduler_alloc_task(void);
@@ -2,14 +2,29 @@
 #define RTOS_SEMAPHORE_H
 
 #include "kernel.h"
+#include "spinlock.h"
 
+/*
+ * Counting semaphore. A negative count is the number of blocked waiters.
+ * Wait and signal first try a single compare-and-swap on count, which
+ * succeeds whenever nobody has to block or be woken; only then do they
+ * take the IRQ-saving spinlock that protects the waiter list.
+ */
 typedef struct {
-    int count;
+    volatile int count;
     TCB_t *waiting;
+    spinlock_t lock;
 } Semaphore_t;
 
 void semaphore_init(Semaphore_t *sem, int init_val);
 void semaphore_wait(Semaphore_t *sem);
 void semaphore_signal(Semaphore_t *sem);
+/*
+ * If sem is unavailable, queue the (already blocked) task on it by
+ * priority as if it had called semaphore_wait and return true; a later
+ * signal wakes it as the owner. Returns false if sem could be taken.
+ * Used by cond_signal.
+ */
+bool semaphore_enqueue_if_held(Semaphore_t *sem, TCB_t *task);
 
 #endif /* RTOS_SEMAPHORE_H */
@@ -0,0 +1,44 @@
+#ifndef RTOS_SPINLOCK_H
+#define RTOS_SPINLOCK_H
+
+#include "atomic.h"
+#include "irq.h"
+
+/*
+ * Test-and-test-and-set spinlock. On a single core it is never contended;
+ * the _irqsave variants give a critical section that is safe against both
+ * local interrupts and other cores.
+ */
+typedef struct {
+    volatile uint32_t locked;
+} spinlock_t;
+
+#define SPINLOCK_INIT { 0 }
+
+static inline void spin_lock_init(spinlock_t *l) {
+    l->locked = 0;
+}
+
+static inline void spin_lock(spinlock_t *l) {
+    while (!atomic_cmpxchg(&l->locked, 0, 1)) {
+        while (atomic_read(&l->locked))
+            cpu_relax();
+    }
+}
+
+static inline void spin_unlock(spinlock_t *l) {
+    atomic_set(&l->locked, 0);
+}
+
+static inline uint32_t spin_lock_irqsave(spinlock_t *l) {
+    uint32_t flags = irq_disable();
+    spin_lock(l);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t *l, uint32_t flags) {
+    spin_unlock(l);
+    irq_restore(flags);
+}
+
+#endif /* RTOS_SPINLOCK_H */
@@ -0,0 +1,48 @@
+#ifndef RTOS_SPSC_H
+#define RTOS_SPSC_H
+
+#include "types.h"
+#include "kernel.h"
+#include "mem.h"
+
+/*
+ * Lock-free single-producer/single-consumer ring for ISR-to-task streams.
+ * Neither side masks IRQs: the producer owns head, the consumer owns tail,
+ * and each index lives on its own cache line next to a cached copy of the
+ * other side's index. Capacity must be a power of two.
+ */
+
+typedef void (*SpscNotify_t)(void *context);
+
+typedef struct {
+    /* Producer line */
+    volatile uint32_t head __attribute__((aligned(CACHE_LINE_SIZE)));
+    uint32_t tail_cache;
+
+    /* Consumer line */
+    volatile uint32_t tail __attribute__((aligned(CACHE_LINE_SIZE)));
+    uint32_t head_cache;
+    TCB_t *volatile waiter;
+
+    /* Read-only after init */
+    uintptr_t *buffer __attribute__((aligned(CACHE_LINE_SIZE)));
+    uint32_t mask;
+    SpscNotify_t notify;
+    void *notify_ctx;
+} SPSC_t;
+
+int spsc_init(SPSC_t *r, size_t capacity);
+void spsc_destroy(SPSC_t *r);
+void spsc_set_notify(SPSC_t *r, SpscNotify_t notify, void *context);
+
+/* Producer side (ISR-safe, never blocks): 0 on success, -1 if full */
+int spsc_push(SPSC_t *r, uintptr_t item);
+
+/* Consumer side: 0 on success, -1 if empty */
+int spsc_pop(SPSC_t *r, uintptr_t *item);
+/* Consumer side, task context: blocks until an item arrives */
+int spsc_pop_wait(SPSC_t *r, uintptr_t *item);
+
+size_t spsc_count(const SPSC_t *r);
+
+#endif /* RTOS_SPSC_H */
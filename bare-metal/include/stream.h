@@ -0,0 +1,38 @@
+#ifndef RTOS_STREAM_H
+#define RTOS_STREAM_H
+
+#include "types.h"
+#include "kernel.h"
+
+/*
+ * Byte-stream buffer (pipe) for one writer and one reader. Data is copied
+ * into and out of a byte ring in at most two contiguous runs. A blocked
+ * reader is only woken once the number of bytes it asked for as its
+ * trigger level is available, not on every write.
+ */
+
+typedef struct {
+    uint8_t *buffer;
+    size_t size;
+    size_t head;            /* next byte to read */
+    size_t tail;            /* next byte to write */
+    size_t count;
+    size_t trigger;         /* bytes the blocked reader is waiting for */
+    TCB_t *reader;          /* blocked reader, if any */
+    TCB_t *writer;          /* blocked writer, if any */
+} Stream_t;
+
+int stream_init(Stream_t *s, size_t size);
+void stream_destroy(Stream_t *s);
+
+/* Blocks while full; returns bytes written (len unless woken without room) */
+size_t stream_write(Stream_t *s, const void *data, size_t len);
+/* Never blocks (ISR-safe); returns bytes written */
+size_t stream_try_write(Stream_t *s, const void *data, size_t len);
+
+/* Blocks until trigger_level bytes are available, then reads up to maxlen */
+size_t stream_read(Stream_t *s, void *buf, size_t maxlen, size_t trigger_level);
+
+size_t stream_available(const Stream_t *s);
+
+#endif /* RTOS_STREAM_H */
@@ -5,7 +5,17 @@
 #include <stddef.h>
 #include <stdbool.h>
 
+/* Word type that may alias any object, for the aligned copy path */
+typedef uint32_t __attribute__((may_alias)) rt_word_t;
+
 static inline void *rt_memcpy(void *dest, const void *src, size_t n) {
+    if ((((uintptr_t)dest | (uintptr_t)src | n) & (sizeof(rt_word_t) - 1)) == 0) {
+        rt_word_t *dw = (rt_word_t *)dest;
+        const rt_word_t *sw = (const rt_word_t *)src;
+        for (n /= sizeof(rt_word_t); n > 0; n--)
+            *dw++ = *sw++;
+        return dest;
+    }
     unsigned char *d = (unsigned char *)dest;
     const unsigned char *s = (const unsigned char *)src;
     while (n--)
@@ -0,0 +1,205 @@
+#include "broker.h"
+#include "mem.h"
+#include "atomic.h"
+
+/* FNV-1a over the name; also reports its length */
+static uint32_t hash_name(const char *name, size_t *len) {
+    uint32_t h = 2166136261u;
+    size_t n = 0;
+    while (name[n]) {
+        h ^= (uint8_t)name[n++];
+        h *= 16777619u;
+    }
+    *len = n;
+    return h;
+}
+
+static size_t name_length(const char *name) {
+    size_t n = 0;
+    while (name[n])
+        n++;
+    return n;
+}
+
+/* Fibonacci hashing spreads sequential IDs across the table */
+static uint32_t hash_id(uint32_t id) {
+    return id * 2654435769u;
+}
+
+static bool names_equal(const char *a, const char *b, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (a[i] != b[i])
+            return false;
+    }
+    return a[len] == '\0';
+}
+
+static bool has_prefix(const char *name, const BrokerWildcard_t *w) {
+    for (size_t i = 0; i < w->len; i++) {
+        if (name[i] != w->prefix[i])
+            return false;
+    }
+    return true;
+}
+
+int broker_init(Broker_t *b, size_t max_topics) {
+    if (max_topics == 0)
+        return -1;
+    /* Keep the load factor at or below one half */
+    size_t size = 2;
+    while (size < 2 * max_topics)
+        size <<= 1;
+    b->slots = (BrokerTopic_t *)my_malloc(size * sizeof(BrokerTopic_t));
+    if (!b->slots)
+        return -1;
+    rt_memset(b->slots, 0, size * sizeof(BrokerTopic_t));
+    b->mask = size - 1;
+    b->count = 0;
+    b->max_topics = max_topics;
+    b->wildcard_count = 0;
+    return 0;
+}
+
+void broker_destroy(Broker_t *b) {
+    if (!b->slots)
+        return;
+    for (size_t i = 0; i <= b->mask; i++) {
+        if (b->slots[i].used)
+            mq_destroy(&b->slots[i].mq);
+    }
+    my_free(b->slots);
+    b->slots = NULL;
+}
+
+/*
+ * Linear probe for a key. Returns the matching slot, or the empty slot
+ * where it would be inserted.
+ */
+static BrokerTopic_t *probe_id(Broker_t *b, uint32_t id) {
+    size_t i = hash_id(id) & b->mask;
+    for (;;) {
+        BrokerTopic_t *t = &b->slots[i];
+        if (!atomic_read(&t->used) || (!t->named && t->id == id))
+            return t;
+        i = (i + 1) & b->mask;
+    }
+}
+
+static BrokerTopic_t *probe_name(Broker_t *b, const char *name, uint32_t hash,
+                                 size_t len) {
+    size_t i = hash & b->mask;
+    for (;;) {
+        BrokerTopic_t *t = &b->slots[i];
+        if (!atomic_read(&t->used) ||
+            (t->named && t->hash == hash && names_equal(t->name, name, len)))
+            return t;
+        i = (i + 1) & b->mask;
+    }
+}
+
+/*
+ * Lookups take no lock, so a slot becomes used only once its key and
+ * queue are complete; atomic_set orders those stores before the flag.
+ */
+static void publish(Broker_t *b, BrokerTopic_t *t) {
+    b->count++;
+    atomic_set(&t->used, 1);
+}
+
+MQ_t *broker_topic(Broker_t *b, uint32_t id) {
+    BrokerTopic_t *t = probe_id(b, id);
+    if (t->used)
+        return &t->mq;
+    if (b->count == b->max_topics)
+        return NULL;
+    t->hash = hash_id(id);
+    t->named = false;
+    t->id = id;
+    mq_init(&t->mq);
+    publish(b, t);
+    return &t->mq;
+}
+
+MQ_t *broker_topic_named(Broker_t *b, const char *name) {
+    size_t len;
+    uint32_t hash = hash_name(name, &len);
+    if (len >= BROKER_NAME_LEN)
+        return NULL;
+    BrokerTopic_t *t = probe_name(b, name, hash, len);
+    if (t->used)
+        return &t->mq;
+    if (b->count == b->max_topics)
+        return NULL;
+    t->hash = hash;
+    t->named = true;
+    rt_memcpy(t->name, name, len + 1);
+    mq_init(&t->mq);
+    /* Matching prefixes are subscribed before anyone can find the topic */
+    for (size_t i = 0; i < b->wildcard_count; i++) {
+        BrokerWildcard_t *w = &b->wildcards[i];
+        if (has_prefix(t->name, w) &&
+            mq_subscribe(&t->mq, w->callback, w->context) != 0) {
+            mq_destroy(&t->mq);
+            return NULL;
+        }
+    }
+    publish(b, t);
+    return &t->mq;
+}
+
+MQ_t *broker_find(Broker_t *b, uint32_t id) {
+    BrokerTopic_t *t = probe_id(b, id);
+    return t->used ? &t->mq : NULL;
+}
+
+MQ_t *broker_find_named(Broker_t *b, const char *name) {
+    size_t len;
+    uint32_t hash = hash_name(name, &len);
+    if (len >= BROKER_NAME_LEN)
+        return NULL;
+    BrokerTopic_t *t = probe_name(b, name, hash, len);
+    return t->used ? &t->mq : NULL;
+}
+
+int broker_publish(Broker_t *b, uint32_t id, void *message) {
+    MQ_t *mq = broker_find(b, id);
+    if (!mq)
+        return -1;
+    return mq_publish(mq, message);
+}
+
+int broker_publish_named(Broker_t *b, const char *name, void *message) {
+    MQ_t *mq = broker_find_named(b, name);
+    if (!mq)
+        return -1;
+    return mq_publish(mq, message);
+}
+
+int broker_subscribe_prefix(Broker_t *b, const char *prefix,
+                            MessageCallback_t callback, void *context) {
+    size_t len = name_length(prefix);
+    if (!callback || len >= BROKER_NAME_LEN ||
+        b->wildcard_count == BROKER_MAX_WILDCARDS)
+        return -1;
+    BrokerWildcard_t *w = &b->wildcards[b->wildcard_count];
+    rt_memcpy(w->prefix, prefix, len + 1);
+    w->len = len;
+    w->callback = callback;
+    w->context = context;
+    for (size_t i = 0; i <= b->mask; i++) {
+        BrokerTopic_t *t = &b->slots[i];
+        if (!t->used || !t->named || !has_prefix(t->name, w))
+            continue;
+        if (mq_subscribe(&t->mq, callback, context) != 0) {
+            /* Undo the topics already covered; the prefix stays unregistered */
+            while (i-- > 0) {
+                t = &b->slots[i];
+                if (t->used && t->named && has_prefix(t->name, w))
+                    mq_unsubscribe(&t->mq, callback, context);
+            }
+            return -1;
+        }
+    }
+    b->wildcard_count++;
+    return 0;
+}
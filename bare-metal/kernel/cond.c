@@ -0,0 +1,84 @@
+#include "cond.h"
+#include "scheduler.h"
+
+/* Weak symbol — overridden by real implementation on bare-metal */
+__attribute__((weak)) void task_yield(void) { }
+
+enum {
+    COND_WAITING,
+    COND_WOKEN,         /* made ready; must take the mutex itself */
+    COND_HANDED_MUTEX   /* queued on the mutex; owns it when it runs */
+};
+
+void cond_init(CondVar_t *cv) {
+    cv->waiting = NULL;
+    cv->mutex = NULL;
+    spin_lock_init(&cv->lock);
+}
+
+/* Highest priority first, FIFO within a level */
+static void enqueue(CondVar_t *cv, CondWaiter_t *w) {
+    CondWaiter_t **link = &cv->waiting;
+    while (*link && (*link)->task->priority <= w->task->priority)
+        link = &(*link)->next;
+    w->next = *link;
+    *link = w;
+}
+
+static void dequeue(CondVar_t *cv, CondWaiter_t *w) {
+    CondWaiter_t **link = &cv->waiting;
+    while (*link && *link != w)
+        link = &(*link)->next;
+    if (*link)
+        *link = w->next;
+}
+
+int cond_wait(CondVar_t *cv, Semaphore_t *mutex) {
+    CondWaiter_t self = { current_tcb, NULL, COND_WAITING };
+    uint32_t flags = spin_lock_irqsave(&cv->lock);
+    cv->mutex = mutex;
+    enqueue(cv, &self);
+    current_tcb->state = TASK_STATE_BLOCKED;
+    /* A signaller needs cv->lock, so it cannot run between these two */
+    semaphore_signal(mutex);
+    spin_unlock_irqrestore(&cv->lock, flags);
+    task_yield();
+
+    flags = spin_lock_irqsave(&cv->lock);
+    uint8_t state = self.state;
+    if (state == COND_WAITING) {
+        dequeue(cv, &self);
+        current_tcb->state = TASK_STATE_RUNNING;
+    }
+    spin_unlock_irqrestore(&cv->lock, flags);
+    if (state != COND_HANDED_MUTEX)
+        semaphore_wait(mutex);
+    return state == COND_WAITING ? -1 : 0;
+}
+
+/* Called with cv->lock held */
+static void wake_one(CondVar_t *cv) {
+    CondWaiter_t *w = cv->waiting;
+    cv->waiting = w->next;
+    if (semaphore_enqueue_if_held(cv->mutex, w->task)) {
+        w->state = COND_HANDED_MUTEX;
+        return;
+    }
+    w->state = COND_WOKEN;
+    w->task->state = TASK_STATE_READY;
+    scheduler_add_task(w->task);
+}
+
+void cond_signal(CondVar_t *cv) {
+    uint32_t flags = spin_lock_irqsave(&cv->lock);
+    if (cv->waiting)
+        wake_one(cv);
+    spin_unlock_irqrestore(&cv->lock, flags);
+}
+
+void cond_broadcast(CondVar_t *cv) {
+    uint32_t flags = spin_lock_irqsave(&cv->lock);
+    while (cv->waiting)
+        wake_one(cv);
+    spin_unlock_irqrestore(&cv->lock, flags);
+}
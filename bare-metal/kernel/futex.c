@@ -0,0 +1,88 @@
+#include "futex.h"
+#include "scheduler.h"
+#include "spinlock.h"
+
+/* Weak symbol — overridden by real implementation on bare-metal */
+__attribute__((weak)) void task_yield(void) { }
+
+/* Lives on the waiting task's stack for the duration of the wait */
+typedef struct FutexWaiter {
+    TCB_t *task;
+    volatile uint32_t *addr;
+    struct FutexWaiter *next;
+    bool woken;
+} FutexWaiter_t;
+
+typedef struct {
+    spinlock_t lock;
+    FutexWaiter_t *waiting;     /* by priority, FIFO within a level */
+} FutexBucket_t;
+
+static FutexBucket_t buckets[FUTEX_BUCKETS];
+
+/* Fibonacci hashing of the word index; the top bits pick the bucket */
+static FutexBucket_t *bucket_of(volatile uint32_t *addr) {
+    uint32_t h = (uint32_t)((uintptr_t)addr >> 2) * 2654435769u;
+    return &buckets[h >> (32 - FUTEX_HASH_BITS)];
+}
+
+static void enqueue(FutexBucket_t *b, FutexWaiter_t *w) {
+    FutexWaiter_t **link = &b->waiting;
+    while (*link && (*link)->task->priority <= w->task->priority)
+        link = &(*link)->next;
+    w->next = *link;
+    *link = w;
+}
+
+static void dequeue(FutexBucket_t *b, FutexWaiter_t *w) {
+    FutexWaiter_t **link = &b->waiting;
+    while (*link && *link != w)
+        link = &(*link)->next;
+    if (*link)
+        *link = w->next;
+}
+
+int futex_wait(volatile uint32_t *addr, uint32_t expected) {
+    FutexBucket_t *b = bucket_of(addr);
+    FutexWaiter_t self = { current_tcb, addr, NULL, false };
+    uint32_t flags = spin_lock_irqsave(&b->lock);
+    if (atomic_read(addr) != expected) {
+        spin_unlock_irqrestore(&b->lock, flags);
+        return -1;
+    }
+    enqueue(b, &self);
+    current_tcb->state = TASK_STATE_BLOCKED;
+    spin_unlock_irqrestore(&b->lock, flags);
+    task_yield();
+
+    flags = spin_lock_irqsave(&b->lock);
+    bool woken = self.woken;
+    if (!woken) {
+        dequeue(b, &self);
+        current_tcb->state = TASK_STATE_RUNNING;
+    }
+    spin_unlock_irqrestore(&b->lock, flags);
+    return woken ? 0 : -1;
+}
+
+uint32_t futex_wake(volatile uint32_t *addr, uint32_t n) {
+    FutexBucket_t *b = bucket_of(addr);
+    uint32_t woken = 0;
+    uint32_t flags = spin_lock_irqsave(&b->lock);
+    FutexWaiter_t **link = &b->waiting;
+    while (*link && woken < n) {
+        FutexWaiter_t *w = *link;
+        if (w->addr != addr) {
+            link = &w->next;
+            continue;
+        }
+        *link = w->next;
+        TCB_t *task = w->task;
+        w->woken = true;
+        task->state = TASK_STATE_READY;
+        scheduler_add_task(task);
+        woken++;
+    }
+    spin_unlock_irqrestore(&b->lock, flags);
+    return woken;
+}
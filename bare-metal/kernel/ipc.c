@@ -6,38 +6,55 @@
 /* Weak symbol — overridden by real implementation on bare-metal */
 __attribute__((weak)) void task_yield(void) { }
 
-static void add_waiting_consumer(IPC_t *q, TCB_t *task) {
+static void add_waiter(WaitingNode **list, TCB_t *task) {
     WaitingNode *node = (WaitingNode *)my_malloc(sizeof(WaitingNode));
     node->task = task;
-    node->next = q->waitingConsumers;
-    q->waitingConsumers = node;
+    node->next = *list;
+    *list = node;
 }
 
-static TCB_t *pop_waiting_consumer(IPC_t *q) {
-    if (!q->waitingConsumers)
+static TCB_t *pop_waiter(WaitingNode **list) {
+    if (!*list)
         return NULL;
-    WaitingNode *node = q->waitingConsumers;
-    q->waitingConsumers = node->next;
+    WaitingNode *node = *list;
+    *list = node->next;
     TCB_t *task = node->task;
     my_free(node);
     return task;
 }
 
+static void free_waiters(WaitingNode **list) {
+    while (*list) {
+        WaitingNode *node = *list;
+        *list = node->next;
+        my_free(node);
+    }
+}
+
+/*
+ * Called with IRQs masked; sleeps on list and masks them again. False if
+ * resumed without a wake-up. True only means "try again": another task
+ * may already have taken what the waker left.
+ */
+static bool wait_on(WaitingNode **list, uint32_t *flags) {
+    add_waiter(list, current_tcb);
+    current_tcb->state = TASK_STATE_BLOCKED;
+    irq_restore(*flags);
+    task_yield();
+    *flags = irq_disable();
+    return current_tcb->state != TASK_STATE_BLOCKED;
+}
+
+static TCB_t *pop_waiting_consumer(IPC_t *q) {
+    return pop_waiter(&q->waitingConsumers);
+}
+
 static void add_waiting_producer(IPC_t *q, TCB_t *task) {
-    WaitingNode *node = (WaitingNode *)my_malloc(sizeof(WaitingNode));
-    node->task = task;
-    node->next = q->waitingProducers;
-    q->waitingProducers = node;
+    add_waiter(&q->waitingProducers, task);
 }
 
 static TCB_t *pop_waiting_producer(IPC_t *q) {
-    if (!q->waitingProducers)
-        return NULL;
-    WaitingNode *node = q->waitingProducers;
-    q->waitingProducers = node->next;
-    TCB_t *task = node->task;
-    my_free(node);
-    return task;
+    return pop_waiter(&q->waitingProducers);
 }
 
 int ipc_init(IPC_t *q, size_t capacity) {
@@ -48,38 +65,80 @@ int ipc_init(IPC_t *q, size_t capacity) {
     q->head = 0;
     q->tail = 0;
     q->count = 0;
+    q->peak = 0;
     q->waitingConsumers = NULL;
     q->waitingProducers = NULL;
+    q->high_mark = capacity;
+    q->low_mark = 0;
+    q->above_high = false;
+    q->on_watermark = NULL;
+    q->watermark_ctx = NULL;
     return 0;
 }
 
+int ipc_set_watermarks(IPC_t *q, size_t high, size_t low,
+                       IPCWatermarkFn_t fn, void *context) {
+    if (fn && (low >= high || high > q->capacity))
+        return -1;
+    uint32_t flags = irq_disable();
+    if (fn) {
+        q->high_mark = high;
+        q->low_mark = low;
+        q->above_high = q->count >= high;
+    }
+    q->watermark_ctx = context;
+    q->on_watermark = fn;
+    irq_restore(flags);
+    return 0;
+}
+
+/*
+ * A crossing to report once the queue is consistent again, before IRQs
+ * are restored: delivered any later, a task preempting us could report
+ * the opposite crossing first.
+ */
+typedef struct {
+    IPCWatermark_t event;
+    IPCWatermarkFn_t fn;
+    void *ctx;
+} WatermarkNote;
+
+/* Called with IRQs masked after count changes; reported before unmasking */
+static WatermarkNote update_depth(IPC_t *q) {
+    WatermarkNote note = { IPC_WATERMARK_NONE, q->on_watermark, q->watermark_ctx };
+    if (q->count > q->peak)
+        q->peak = q->count;
+    if (!note.fn)
+        return note;
+    if (!q->above_high && q->count >= q->high_mark) {
+        q->above_high = true;
+        note.event = IPC_WATERMARK_HIGH;
+    } else if (q->above_high && q->count <= q->low_mark) {
+        q->above_high = false;
+        note.event = IPC_WATERMARK_LOW;
+    }
+    return note;
+}
+
+/* Called with IRQs still masked */
+static void notify_watermark(IPC_t *q, WatermarkNote note) {
+    if (note.event != IPC_WATERMARK_NONE)
+        note.fn(q, note.event, note.ctx);
+}
+
 void ipc_destroy(IPC_t *q) {
     if (q->buffer)
         my_free(q->buffer);
-    while (q->waitingConsumers) {
-        WaitingNode *node = q->waitingConsumers;
-        q->waitingConsumers = node->next;
-        my_free(node);
-    }
-    while (q->waitingProducers) {
-        WaitingNode *node = q->waitingProducers;
-        q->waitingProducers = node->next;
-        my_free(node);
-    }
+    free_waiters(&q->waitingConsumers);
+    free_waiters(&q->waitingProducers);
 }
 
-int ipc_send(IPC_t *q, void *message) {
-    uint32_t flags = irq_disable();
-    if (q->count == q->capacity) {
-        add_waiting_producer(q, current_tcb);
-        current_tcb->state = TASK_STATE_BLOCKED;
-        irq_restore(flags);
-        task_yield();
-        flags = irq_disable();
-    }
+/* Called with IRQs masked and a free slot; wakes one consumer */
+static WatermarkNote put_one(IPC_t *q, void *message) {
     q->buffer[q->tail] = message;
     q->tail = (q->tail + 1) % q->capacity;
     q->count++;
+    WatermarkNote note = update_depth(q);
     if (q->waitingConsumers) {
         TCB_t *consumer = pop_waiting_consumer(q);
         if (consumer) {
@@ -87,22 +146,15 @@ int ipc_send(IPC_t *q, void *message) {
             scheduler_add_task(consumer);
         }
     }
-    irq_restore(flags);
-    return 0;
+    return note;
 }
 
-int ipc_receive(IPC_t *q, void **message) {
-    uint32_t flags = irq_disable();
-    if (q->count == 0) {
-        add_waiting_consumer(q, current_tcb);
-        current_tcb->state = TASK_STATE_BLOCKED;
-        irq_restore(flags);
-        task_yield();
-        flags = irq_disable();
-    }
+/* Called with IRQs masked and a queued message; wakes one producer */
+static WatermarkNote get_one(IPC_t *q, void **message) {
     *message = q->buffer[q->head];
     q->head = (q->head + 1) % q->capacity;
     q->count--;
+    WatermarkNote note = update_depth(q);
     if (q->waitingProducers) {
         TCB_t *producer = pop_waiting_producer(q);
         if (producer) {
@@ -110,6 +162,404 @@ int ipc_receive(IPC_t *q, void **message) {
             scheduler_add_task(producer);
         }
     }
+    return note;
+}
+
+int ipc_send(IPC_t *q, void *message) {
+    uint32_t flags = irq_disable();
+    while (q->count == q->capacity) {
+        if (!wait_on(&q->waitingProducers, &flags)) {
+            irq_restore(flags);
+            return -1;
+        }
+    }
+    WatermarkNote note = put_one(q, message);
+    notify_watermark(q, note);
+    irq_restore(flags);
+    return 0;
+}
+
+int ipc_receive(IPC_t *q, void **message) {
+    uint32_t flags = irq_disable();
+    while (q->count == 0) {
+        if (!wait_on(&q->waitingConsumers, &flags)) {
+            irq_restore(flags);
+            return -1;
+        }
+    }
+    WatermarkNote note = get_one(q, message);
+    notify_watermark(q, note);
+    irq_restore(flags);
+    return 0;
+}
+
+int ipc_try_send(IPC_t *q, void *message) {
+    uint32_t flags = irq_disable();
+    if (q->count == q->capacity) {
+        irq_restore(flags);
+        return -1;
+    }
+    WatermarkNote note = put_one(q, message);
+    notify_watermark(q, note);
+    irq_restore(flags);
+    return 0;
+}
+
+int ipc_try_receive(IPC_t *q, void **message) {
+    uint32_t flags = irq_disable();
+    if (q->count == 0) {
+        irq_restore(flags);
+        return -1;
+    }
+    WatermarkNote note = get_one(q, message);
+    notify_watermark(q, note);
+    irq_restore(flags);
+    return 0;
+}
+
+int ipc_send_overwrite(IPC_t *q, void *message, void **evicted) {
+    uint32_t flags = irq_disable();
+    *evicted = NULL;
+    if (q->count == q->capacity) {
+        /* Drop the oldest; a full queue has no waiting consumers */
+        *evicted = q->buffer[q->head];
+        q->head = (q->head + 1) % q->capacity;
+        q->count--;
+    }
+    WatermarkNote note = put_one(q, message);
+    notify_watermark(q, note);
+    irq_restore(flags);
+    return *evicted ? 1 : 0;
+}
+
+/* Copy up to n messages into the ring as at most two contiguous runs */
+static size_t ring_put(IPC_t *q, void *const *messages, size_t n) {
+    size_t space = q->capacity - q->count;
+    if (n > space)
+        n = space;
+    size_t first = q->capacity - q->tail;
+    if (first > n)
+        first = n;
+    for (size_t i = 0; i < first; i++)
+        q->buffer[q->tail + i] = messages[i];
+    for (size_t i = first; i < n; i++)
+        q->buffer[i - first] = messages[i];
+    q->tail += n;
+    if (q->tail >= q->capacity)
+        q->tail -= q->capacity;
+    q->count += n;
+    return n;
+}
+
+static size_t ring_get(IPC_t *q, void **messages, size_t n) {
+    if (n > q->count)
+        n = q->count;
+    size_t first = q->capacity - q->head;
+    if (first > n)
+        first = n;
+    for (size_t i = 0; i < first; i++)
+        messages[i] = q->buffer[q->head + i];
+    for (size_t i = first; i < n; i++)
+        messages[i] = q->buffer[i - first];
+    q->head += n;
+    if (q->head >= q->capacity)
+        q->head -= q->capacity;
+    q->count -= n;
+    return n;
+}
+
+int ipc_send_many(IPC_t *q, void *const *messages, size_t n) {
+    size_t sent = 0;
+    while (sent < n) {
+        uint32_t flags = irq_disable();
+        /* Another producer may take the slot we were woken for: block again */
+        while (q->count == q->capacity) {
+            add_waiting_producer(q, current_tcb);
+            current_tcb->state = TASK_STATE_BLOCKED;
+            irq_restore(flags);
+            task_yield();
+            flags = irq_disable();
+        }
+        size_t k = ring_put(q, messages + sent, n - sent);
+        sent += k;
+        WatermarkNote note = update_depth(q);
+        /* One pass over the waiters for the whole run */
+        while (k-- > 0 && q->waitingConsumers) {
+            TCB_t *consumer = pop_waiting_consumer(q);
+            consumer->state = TASK_STATE_READY;
+            scheduler_add_task(consumer);
+        }
+        notify_watermark(q, note);
+        irq_restore(flags);
+    }
+    return (int)sent;
+}
+
+int ipc_receive_many(IPC_t *q, void **messages, size_t max) {
+    if (max == 0)
+        return 0;
+    uint32_t flags = irq_disable();
+    while (q->count == 0) {
+        if (!wait_on(&q->waitingConsumers, &flags)) {
+            irq_restore(flags);
+            return 0;
+        }
+    }
+    size_t k = ring_get(q, messages, max);
+    size_t n = k;
+    WatermarkNote note = update_depth(q);
+    while (k-- > 0 && q->waitingProducers) {
+        TCB_t *producer = pop_waiting_producer(q);
+        producer->state = TASK_STATE_READY;
+        scheduler_add_task(producer);
+    }
+    notify_watermark(q, note);
+    irq_restore(flags);
+    return (int)n;
+}
+
+int ipc_copy_init(IPCCopy_t *q, size_t capacity, size_t item_size) {
+    if (capacity == 0 || item_size == 0)
+        return -1;
+    /* Round slots up to a word so aligned payloads take the word-copy path */
+    q->stride = (item_size + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+    q->buffer = (uint8_t *)my_malloc(capacity * q->stride);
+    if (!q->buffer)
+        return -1;
+    q->item_size = item_size;
+    q->capacity = capacity;
+    q->head = 0;
+    q->tail = 0;
+    q->count = 0;
+    q->waitingConsumers = NULL;
+    q->waitingProducers = NULL;
+    return 0;
+}
+
+void ipc_copy_destroy(IPCCopy_t *q) {
+    if (q->buffer)
+        my_free(q->buffer);
+    free_waiters(&q->waitingConsumers);
+    free_waiters(&q->waitingProducers);
+}
+
+int ipc_copy_send(IPCCopy_t *q, const void *item) {
+    uint32_t flags = irq_disable();
+    while (q->count == q->capacity) {
+        if (!wait_on(&q->waitingProducers, &flags)) {
+            irq_restore(flags);
+            return -1;
+        }
+    }
+    rt_memcpy(q->buffer + q->tail * q->stride, item, q->item_size);
+    if (++q->tail == q->capacity)
+        q->tail = 0;
+    q->count++;
+    TCB_t *consumer = pop_waiter(&q->waitingConsumers);
+    if (consumer) {
+        consumer->state = TASK_STATE_READY;
+        scheduler_add_task(consumer);
+    }
+    irq_restore(flags);
+    return 0;
+}
+
+int ipc_copy_receive(IPCCopy_t *q, void *item) {
+    uint32_t flags = irq_disable();
+    while (q->count == 0) {
+        if (!wait_on(&q->waitingConsumers, &flags)) {
+            irq_restore(flags);
+            return -1;
+        }
+    }
+    rt_memcpy(item, q->buffer + q->head * q->stride, q->item_size);
+    if (++q->head == q->capacity)
+        q->head = 0;
+    q->count--;
+    TCB_t *producer = pop_waiter(&q->waitingProducers);
+    if (producer) {
+        producer->state = TASK_STATE_READY;
+        scheduler_add_task(producer);
+    }
+    irq_restore(flags);
+    return 0;
+}
+
+int ipc_prio_init(IPCPrio_t *q, size_t capacity) {
+    if (capacity == 0)
+        return -1;
+    q->nodes = (IPCPrioNode *)my_malloc(capacity * sizeof(IPCPrioNode));
+    if (!q->nodes)
+        return -1;
+    q->free = NULL;
+    for (size_t i = capacity; i-- > 0; ) {
+        q->nodes[i].next = q->free;
+        q->free = &q->nodes[i];
+    }
+    for (int p = 0; p < IPC_PRIO_LEVELS; p++) {
+        q->head[p] = NULL;
+        q->tail[p] = NULL;
+    }
+    q->ready = 0;
+    q->capacity = capacity;
+    q->count = 0;
+    q->waitingConsumers = NULL;
+    q->waitingProducers = NULL;
+    return 0;
+}
+
+void ipc_prio_destroy(IPCPrio_t *q) {
+    if (q->nodes)
+        my_free(q->nodes);
+    free_waiters(&q->waitingConsumers);
+    free_waiters(&q->waitingProducers);
+}
+
+int ipc_prio_send(IPCPrio_t *q, void *message, uint8_t priority) {
+    if (priority >= IPC_PRIO_LEVELS)
+        return -1;
+    uint32_t flags = irq_disable();
+    while (!q->free) {
+        if (!wait_on(&q->waitingProducers, &flags)) {
+            irq_restore(flags);
+            return -1;
+        }
+    }
+    IPCPrioNode *node = q->free;
+    q->free = node->next;
+    node->message = message;
+    node->next = NULL;
+    if (q->tail[priority])
+        q->tail[priority]->next = node;
+    else
+        q->head[priority] = node;
+    q->tail[priority] = node;
+    q->ready |= 1u << priority;
+    q->count++;
+    TCB_t *consumer = pop_waiter(&q->waitingConsumers);
+    if (consumer) {
+        consumer->state = TASK_STATE_READY;
+        scheduler_add_task(consumer);
+    }
+    irq_restore(flags);
+    return 0;
+}
+
+int ipc_prio_receive(IPCPrio_t *q, void **message) {
+    uint32_t flags = irq_disable();
+    while (!q->ready) {
+        if (!wait_on(&q->waitingConsumers, &flags)) {
+            irq_restore(flags);
+            return -1;
+        }
+    }
+    /* Lowest set bit is the highest non-empty priority */
+    int p = __builtin_ctz(q->ready);
+    IPCPrioNode *node = q->head[p];
+    q->head[p] = node->next;
+    if (!q->head[p]) {
+        q->tail[p] = NULL;
+        q->ready &= ~(1u << p);
+    }
+    *message = node->message;
+    node->next = q->free;
+    q->free = node;
+    q->count--;
+    TCB_t *producer = pop_waiter(&q->waitingProducers);
+    if (producer) {
+        producer->state = TASK_STATE_READY;
+        scheduler_add_task(producer);
+    }
+    irq_restore(flags);
+    return 0;
+}
+
+void ipc_endpoint_init(IPCEndpoint_t *ep) {
+    ep->server = NULL;
+    ep->server_waiting = false;
+    ep->client = NULL;
+    ep->callers = NULL;
+}
+
+/* Raise the server to the caller's priority for the duration of the call */
+static void donate_priority(TCB_t *server, uint8_t priority) {
+    if (priority < server->priority)
+        scheduler_set_priority(server, priority);
+}
+
+/* Highest priority first, FIFO within a level */
+static void add_caller(IPCEndpoint_t *ep, TCB_t *task) {
+    TCB_t **link = &ep->callers;
+    while (*link && (*link)->priority <= task->priority)
+        link = &(*link)->next;
+    task->next = *link;
+    *link = task;
+}
+
+int ipc_call(IPCEndpoint_t *ep, void *request, void **reply) {
+    uint32_t flags = irq_disable();
+    current_tcb->message = request;
+    current_tcb->state = TASK_STATE_BLOCKED;
+    if (ep->server_waiting) {
+        /* Hand the request straight to the server */
+        TCB_t *server = ep->server;
+        ep->server_waiting = false;
+        ep->client = current_tcb;
+        server->message = request;
+        donate_priority(server, current_tcb->priority);
+        scheduler_add_task(server);
+    } else {
+        add_caller(ep, current_tcb);
+        if (ep->server)
+            donate_priority(ep->server, current_tcb->priority);
+    }
+    irq_restore(flags);
+    task_yield();
+
+    flags = irq_disable();
+    if (current_tcb->state == TASK_STATE_BLOCKED) {
+        irq_restore(flags);
+        return -1;
+    }
+    *reply = current_tcb->message;
+    irq_restore(flags);
+    return 0;
+}
+
+int ipc_reply_wait(IPCEndpoint_t *ep, void *reply, void **request) {
+    uint32_t flags = irq_disable();
+    ep->server = current_tcb;
+    if (ep->client) {
+        TCB_t *client = ep->client;
+        ep->client = NULL;
+        client->message = reply;
+        scheduler_add_task(client);
+    }
+    /* Running, so not on a ready queue: drop any donation directly */
+    current_tcb->priority = current_tcb->base_priority;
+
+    if (ep->callers) {
+        TCB_t *caller = ep->callers;
+        ep->callers = caller->next;
+        caller->next = NULL;
+        ep->client = caller;
+        donate_priority(current_tcb, caller->priority);
+        *request = caller->message;
+        irq_restore(flags);
+        return 0;
+    }
+
+    ep->server_waiting = true;
+    current_tcb->state = TASK_STATE_BLOCKED;
+    irq_restore(flags);
+    task_yield();
+
+    flags = irq_disable();
+    if (ep->server_waiting) {
+        irq_restore(flags);
+        return -1;
+    }
+    *request = current_tcb->message;
     irq_restore(flags);
     return 0;
 }
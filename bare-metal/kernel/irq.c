@@ -23,6 +23,12 @@ void irq_enable(void) {
     __asm__ volatile("cpsie i");
 }
 
+uint32_t cpu_id(void) {
+    uint32_t mpidr;
+    __asm__ volatile("mrc p15, 0, %0, c0, c0, 5" : "=r"(mpidr));
+    return mpidr & 3;
+}
+
 /* Context switch declared in assembly */
 extern void context_switch(uint32_t **old_sp, uint32_t *new_sp);
 
@@ -47,6 +47,7 @@ int task_create(TaskFunction_t func, uint8_t priority) {
         return -1;
 
     tcb->priority = priority;
+    tcb->base_priority = priority;
     tcb->delay_ticks = 0;
     tcb->message = NULL;
 
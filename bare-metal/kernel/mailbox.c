@@ -0,0 +1,100 @@
+#include "mailbox.h"
+#include "mem.h"
+#include "scheduler.h"
+#include "atomic.h"
+
+/* Weak symbol — overridden by real implementation on bare-metal */
+__attribute__((weak)) void task_yield(void) { }
+
+int mailbox_init(Mailbox_t *mb, size_t size) {
+    if (size == 0)
+        return -1;
+    mb->data = (uint8_t *)my_malloc(size);
+    if (!mb->data)
+        return -1;
+    /* A peek before the first post reads zeros, not stale heap bytes */
+    rt_memset(mb->data, 0, size);
+    mb->size = size;
+    mb->seq = 0;
+    spin_lock_init(&mb->lock);
+    mb->waiting = NULL;
+    return 0;
+}
+
+void mailbox_destroy(Mailbox_t *mb) {
+    if (mb->data)
+        my_free(mb->data);
+    mb->data = NULL;
+}
+
+void mailbox_post(Mailbox_t *mb, const void *value) {
+    uint32_t flags = spin_lock_irqsave(&mb->lock);
+    uint32_t seq = mb->seq;
+    atomic_set(&mb->seq, seq + 1);
+    /* The odd count must be visible before any byte of the new value */
+    smp_mb();
+    rt_memcpy(mb->data, value, mb->size);
+    atomic_set(&mb->seq, seq + 2);
+
+    TCB_t *task = mb->waiting;
+    mb->waiting = NULL;
+    while (task) {
+        TCB_t *next = task->next;
+        task->next = NULL;
+        scheduler_add_task(task);
+        task = next;
+    }
+    spin_unlock_irqrestore(&mb->lock, flags);
+}
+
+uint32_t mailbox_peek(Mailbox_t *mb, void *out) {
+    uint32_t seq;
+    do {
+        while ((seq = atomic_read(&mb->seq)) & 1)
+            cpu_relax();
+        rt_memcpy(out, mb->data, mb->size);
+        /* Order the copy before the recheck */
+        smp_mb();
+    } while (atomic_read(&mb->seq) != seq);
+    return seq;
+}
+
+int mailbox_read_new(Mailbox_t *mb, void *out, uint32_t *version) {
+    uint32_t seq = mailbox_peek(mb, out);
+    if (seq != *version) {
+        *version = seq;
+        return 0;
+    }
+
+    /* Posts take the same lock, so none can slip in between check and block */
+    uint32_t flags = spin_lock_irqsave(&mb->lock);
+    if (mb->seq != *version) {
+        rt_memcpy(out, mb->data, mb->size);
+        *version = mb->seq;
+        spin_unlock_irqrestore(&mb->lock, flags);
+        return 0;
+    }
+    current_tcb->state = TASK_STATE_BLOCKED;
+    current_tcb->next = mb->waiting;
+    mb->waiting = current_tcb;
+    spin_unlock_irqrestore(&mb->lock, flags);
+    task_yield();
+
+    flags = spin_lock_irqsave(&mb->lock);
+    if (current_tcb->state == TASK_STATE_BLOCKED) {
+        /* Resumed without a post: we are still on the list */
+        TCB_t **link = &mb->waiting;
+        while (*link != current_tcb)
+            link = &(*link)->next;
+        *link = current_tcb->next;
+        current_tcb->next = NULL;
+        current_tcb->state = TASK_STATE_RUNNING;
+    }
+    spin_unlock_irqrestore(&mb->lock, flags);
+
+    seq = mailbox_peek(mb, out);
+    if (seq == *version)
+        return -1;
+    *version = seq;
+    return 0;
+}
@@ -1,4 +1,6 @@
 #include "mem.h"
+#include "kernel.h"
+#include "spinlock.h"
 
 typedef long Align;
 
@@ -13,41 +15,116 @@ union header {
 typedef union header Header;
 
 #define HEAP_SIZE (1024 * 1024)
-static char my_heap[HEAP_SIZE];
+static char my_heap[HEAP_SIZE] __attribute__((aligned(sizeof(Header))));
 static char *heap_ptr;
 static char *heap_end = my_heap + HEAP_SIZE;
 
 static Header *freep = NULL;
 
-void init_allocator(void) {
+/* Guards freep, heap_ptr and the global counters below */
+static spinlock_t heap_lock = SPINLOCK_INIT;
+
+/* Statistics counters: plain increments, cheap enough for release builds */
+static uint32_t alloc_count;
+static uint32_t free_count;
+static uint32_t failed_allocs;
+
+/*
+ * Per-core magazines: small blocks of MAG_MIN_UNITS..MAG_MAX_UNITS units
+ * are recycled through a per-core stack with only local IRQs masked.
+ * The shared heap lock is taken once per MAG_BATCH blocks on refill/drain.
+ */
+#define MAG_MIN_UNITS 2
+#define MAG_MAX_UNITS 9
+#define MAG_CLASSES   (MAG_MAX_UNITS - MAG_MIN_UNITS + 1)
+#define MAG_DEPTH     8
+#define MAG_BATCH     (MAG_DEPTH / 2)
+
+typedef struct {
+    Header *blocks[MAG_CLASSES][MAG_DEPTH];
+    uint8_t count[MAG_CLASSES];
+    uint32_t allocs;
+    uint32_t frees;
+} __attribute__((aligned(CACHE_LINE_SIZE))) CoreCache;
+
+static CoreCache core_cache[MAX_CPUS];
+
+#ifdef MEM_CALLSITE_STATS
+static MemCallsite_t callsites[MEM_CALLSITE_SLOTS];
+
+/*
+ * Find or claim the histogram slot for a call site. Sites beyond
+ * MEM_CALLSITE_SLOTS share the last slot, keyed NULL.
+ */
+static MemCallsite_t *callsite_slot(void *site) {
+    for (int i = 0; i < MEM_CALLSITE_SLOTS - 1; i++) {
+        if (callsites[i].site == site)
+            return &callsites[i];
+        if (callsites[i].site == NULL && callsites[i].allocs == 0) {
+            callsites[i].site = site;
+            return &callsites[i];
+        }
+    }
+    return &callsites[MEM_CALLSITE_SLOTS - 1];
+}
+
+/* Caller holds heap_lock. The next link is unused while a block is allocated */
+static void callsite_alloc(Header *p, void *site) {
+    MemCallsite_t *cs = callsite_slot(site);
+    cs->allocs++;
+    cs->bytes += p->s.size * sizeof(Header);
+    p->s.next = (Header *)cs;
+}
+
+static void callsite_free(Header *bp) {
+    MemCallsite_t *cs = (MemCallsite_t *)bp->s.next;
+    cs->frees++;
+    cs->bytes -= bp->s.size * sizeof(Header);
+}
+#endif
+
+static void free_block(Header *bp);
+
+/*
+ * Set up the empty free list. Called lazily with heap_lock held, so it
+ * must not touch the lock or the per-core magazines.
+ */
+static void init_heap(void) {
     freep = (Header *)my_heap;
     freep->s.size = 0;
     freep->s.next = freep;
     heap_ptr = my_heap + sizeof(Header);
 }
 
+void init_allocator(void) {
+    spin_lock_init(&heap_lock);
+    alloc_count = 0;
+    free_count = 0;
+    failed_allocs = 0;
+    rt_memset(core_cache, 0, sizeof(core_cache));
+#ifdef MEM_CALLSITE_STATS
+    rt_memset(callsites, 0, sizeof(callsites));
+#endif
+    init_heap();
+}
+
 static Header *morecore(size_t nu) {
     size_t nbytes = nu * sizeof(Header);
-    if (heap_ptr + nbytes > heap_end)
+    if (nbytes > (size_t)(heap_end - heap_ptr))
         return NULL;
     Header *up = (Header *)heap_ptr;
     up->s.size = nu;
     heap_ptr += nbytes;
-    my_free((void *)(up + 1));
+    free_block(up);
     return freep;
 }
 
-void *my_malloc(size_t nbytes) {
+/* K&R first fit. Caller holds heap_lock */
+static Header *alloc_units(size_t nunits) {
     Header *p, *prevp;
-    size_t nunits;
-
-    if (nbytes == 0)
-        nbytes = 1;
-
-    nunits = (nbytes + sizeof(Header) - 1) / sizeof(Header) + 1;
 
     if (freep == NULL)
-        init_allocator();
+        init_heap();
 
     prevp = freep;
     for (p = prevp->s.next;; prevp = p, p = p->s.next) {
@@ -60,21 +137,253 @@ void *my_malloc(size_t nbytes) {
                 p->s.size = nunits;
             }
             freep = prevp;
-            return (void *)(p + 1);
+            return p;
+        }
+        if (p == freep) {
+            if ((p = morecore(nunits)) == NULL)
+                return NULL;
+        }
+    }
+}
+
+/*
+ * Carve an aligned block out of the free list. The gap in front of the
+ * aligned header stays on the free list as its own block and the remainder
+ * after it is split off, so only whole units are ever consumed.
+ * Caller holds heap_lock.
+ */
+static Header *memalign_units(size_t alignment, size_t nunits) {
+    Header *p, *prevp;
+
+    if (freep == NULL)
+        init_heap();
+
+    prevp = freep;
+    for (p = prevp->s.next;; prevp = p, p = p->s.next) {
+        if (p->s.size >= nunits) {
+            uintptr_t payload = ((uintptr_t)(p + 1) + alignment - 1) &
+                                ~(uintptr_t)(alignment - 1);
+            Header *q = (Header *)payload - 1;
+            size_t lead = (size_t)(q - p);
+
+            if (p->s.size >= lead + nunits) {
+                size_t tail = p->s.size - lead - nunits;
+                Header *next = p->s.next;
+                if (tail > 0) {
+                    Header *r = q + nunits;
+                    r->s.size = tail;
+                    r->s.next = next;
+                    next = r;
+                }
+                if (lead > 0) {
+                    p->s.size = lead;
+                    p->s.next = next;
+                    freep = p;
+                } else {
+                    prevp->s.next = next;
+                    freep = prevp;
+                }
+                q->s.size = nunits;
+                return q;
+            }
         }
         if (p == freep) {
-            Header *more = morecore(nunits);
-            if (more == NULL)
+            /* Worst case the aligned header lands alignment - 1 bytes in */
+            if ((p = morecore(nunits + alignment / sizeof(Header))) == NULL)
                 return NULL;
         }
     }
 }
 
+/* Refill an empty magazine from the shared heap. IRQs are already masked */
+static void cache_refill(CoreCache *cc, size_t c) {
+    spin_lock(&heap_lock);
+    while (cc->count[c] < MAG_BATCH) {
+        Header *p = alloc_units(c + MAG_MIN_UNITS);
+        if (p == NULL)
+            break;
+        cc->blocks[c][cc->count[c]++] = p;
+    }
+    spin_unlock(&heap_lock);
+}
+
+/* Return the oldest n blocks of a magazine to the shared heap */
+static void cache_drain(CoreCache *cc, size_t c, size_t n) {
+    spin_lock(&heap_lock);
+    for (size_t i = 0; i < n; i++)
+        free_block(cc->blocks[c][i]);
+    spin_unlock(&heap_lock);
+    for (size_t i = n; i < cc->count[c]; i++)
+        cc->blocks[c][i - n] = cc->blocks[c][i];
+    cc->count[c] -= n;
+}
+
+static Header *cache_alloc(size_t nunits) {
+    size_t c = nunits - MAG_MIN_UNITS;
+    Header *p = NULL;
+    uint32_t flags = irq_disable();
+    CoreCache *cc = &core_cache[cpu_id()];
+    if (cc->count[c] == 0)
+        cache_refill(cc, c);
+    if (cc->count[c] > 0) {
+        p = cc->blocks[c][--cc->count[c]];
+        cc->allocs++;
+    }
+    irq_restore(flags);
+    return p;
+}
+
+static void cache_free(Header *bp) {
+    size_t c = bp->s.size - MAG_MIN_UNITS;
+    uint32_t flags = irq_disable();
+    CoreCache *cc = &core_cache[cpu_id()];
+    if (cc->count[c] == MAG_DEPTH)
+        cache_drain(cc, c, MAG_BATCH);
+    cc->blocks[c][cc->count[c]++] = bp;
+    cc->frees++;
+    irq_restore(flags);
+}
+
+static void count_failure(void) {
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    failed_allocs++;
+    spin_unlock_irqrestore(&heap_lock, flags);
+}
+
+static void *malloc_from(size_t nbytes, void *site) {
+    Header *p;
+    size_t nunits;
+
+    (void)site;
+
+    if (nbytes == 0)
+        nbytes = 1;
+
+    if (nbytes > HEAP_SIZE) {
+        count_failure();
+        return NULL;
+    }
+
+    nunits = (nbytes + sizeof(Header) - 1) / sizeof(Header) + 1;
+
+    if (nunits <= MAG_MAX_UNITS) {
+        p = cache_alloc(nunits);
+        if (p != NULL) {
+#ifdef MEM_CALLSITE_STATS
+            uint32_t flags = spin_lock_irqsave(&heap_lock);
+            callsite_alloc(p, site);
+            spin_unlock_irqrestore(&heap_lock, flags);
+#endif
+            return (void *)(p + 1);
+        }
+    }
+
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    p = alloc_units(nunits);
+    if (p != NULL) {
+        alloc_count++;
+#ifdef MEM_CALLSITE_STATS
+        callsite_alloc(p, site);
+#endif
+    } else {
+        failed_allocs++;
+    }
+    spin_unlock_irqrestore(&heap_lock, flags);
+    return p ? (void *)(p + 1) : NULL;
+}
+
+static void *memalign_from(size_t alignment, size_t nbytes, void *site) {
+    Header *p;
+    size_t nunits;
+
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        count_failure();
+        return NULL;
+    }
+    if (alignment <= sizeof(Header))
+        return malloc_from(nbytes, site);
+
+    if (nbytes == 0)
+        nbytes = 1;
+
+    if (nbytes > HEAP_SIZE || alignment > HEAP_SIZE) {
+        count_failure();
+        return NULL;
+    }
+
+    nunits = (nbytes + sizeof(Header) - 1) / sizeof(Header) + 1;
+
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    p = memalign_units(alignment, nunits);
+    if (p != NULL) {
+        alloc_count++;
+#ifdef MEM_CALLSITE_STATS
+        callsite_alloc(p, site);
+#endif
+    } else {
+        failed_allocs++;
+    }
+    spin_unlock_irqrestore(&heap_lock, flags);
+    return p ? (void *)(p + 1) : NULL;
+}
+
+void *my_malloc(size_t nbytes) {
+    return malloc_from(nbytes, __builtin_return_address(0));
+}
+
+void *my_memalign(size_t alignment, size_t nbytes) {
+    return memalign_from(alignment, nbytes, __builtin_return_address(0));
+}
+
+void *my_malloc_flags(size_t nbytes, uint32_t flags) {
+    void *site = __builtin_return_address(0);
+    if (flags & MEM_CACHE_ALIGNED) {
+        /* Round up so no other allocation shares the last line */
+        if (nbytes > HEAP_SIZE) {
+            count_failure();
+            return NULL;
+        }
+        nbytes = (nbytes + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1);
+        return memalign_from(CACHE_LINE_SIZE, nbytes, site);
+    }
+    return malloc_from(nbytes, site);
+}
+
 void my_free(void *ap) {
     if (ap == NULL)
         return;
 
     Header *bp = (Header *)ap - 1;
+    uint32_t flags;
+#ifdef MEM_CALLSITE_STATS
+    flags = spin_lock_irqsave(&heap_lock);
+    callsite_free(bp);
+    spin_unlock_irqrestore(&heap_lock, flags);
+#endif
+    if (bp->s.size >= MAG_MIN_UNITS && bp->s.size <= MAG_MAX_UNITS) {
+        cache_free(bp);
+        return;
+    }
+
+    flags = spin_lock_irqsave(&heap_lock);
+    free_count++;
+    free_block(bp);
+    spin_unlock_irqrestore(&heap_lock, flags);
+}
+
+void mem_flush_cache(void) {
+    uint32_t flags = irq_disable();
+    CoreCache *cc = &core_cache[cpu_id()];
+    for (size_t c = 0; c < MAG_CLASSES; c++) {
+        if (cc->count[c] > 0)
+            cache_drain(cc, c, cc->count[c]);
+    }
+    irq_restore(flags);
+}
+
+/* Insert a block into the address-ordered free list, coalescing neighbours.
+ * Caller holds heap_lock. */
+static void free_block(Header *bp) {
     Header *p;
 
     for (p = freep; !(bp > p && bp < p->s.next); p = p->s.next) {
@@ -101,14 +410,14 @@ void my_free(void *ap) {
 
 void *my_realloc(void *ptr, size_t size) {
     if (!ptr)
-        return my_malloc(size);
+        return malloc_from(size, __builtin_return_address(0));
     if (size == 0) {
         my_free(ptr);
         return NULL;
     }
     Header *bp = (Header *)ptr - 1;
     size_t old_size = (bp->s.size - 1) * sizeof(Header);
-    void *new_ptr = my_malloc(size);
+    void *new_ptr = malloc_from(size, __builtin_return_address(0));
     if (!new_ptr)
         return NULL;
     size_t copy_size = old_size < size ? old_size : size;
@@ -116,3 +425,115 @@ void *my_realloc(void *ptr, size_t size) {
     my_free(ptr);
     return new_ptr;
 }
+
+int arena_init(Arena_t *a, size_t size) {
+    a->base = (char *)malloc_from(size, __builtin_return_address(0));
+    if (!a->base)
+        return -1;
+    a->size = size;
+    a->used = 0;
+    return 0;
+}
+
+void arena_destroy(Arena_t *a) {
+    my_free(a->base);
+    a->base = NULL;
+    a->size = 0;
+    a->used = 0;
+}
+
+void *arena_alloc(Arena_t *a, size_t nbytes) {
+    /* Rounding up would wrap to a tiny size */
+    if (nbytes > SIZE_MAX - sizeof(Header) + 1)
+        return NULL;
+    /* Keep the same alignment guarantee as my_malloc */
+    size_t n = (nbytes + sizeof(Header) - 1) & ~(sizeof(Header) - 1);
+    if (n == 0)
+        n = sizeof(Header);
+    if (n > a->size - a->used)
+        return NULL;
+    void *p = a->base + a->used;
+    a->used += n;
+    return p;
+}
+
+size_t arena_mark(const Arena_t *a) {
+    return a->used;
+}
+
+void arena_rewind(Arena_t *a, size_t mark) {
+    if (mark <= a->used)
+        a->used = mark;
+}
+
+void arena_reset(Arena_t *a) {
+    a->used = 0;
+}
+
+void mem_get_stats(MemStats_t *stats) {
+    size_t free_units = 0;
+    size_t largest = 0;
+    size_t blocks = 0;
+    size_t cached_units = 0;
+    size_t cached_blocks = 0;
+    uint32_t allocs, frees;
+    uint32_t hits = 0;
+
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    if (freep == NULL)
+        init_heap();
+
+    /* Walk the free list once; the size-0 base header is skipped */
+    Header *p = freep;
+    do {
+        if (p->s.size > 0) {
+            free_units += p->s.size;
+            if (p->s.size > largest)
+                largest = p->s.size;
+            blocks++;
+        }
+        p = p->s.next;
+    } while (p != freep);
+
+    allocs = alloc_count;
+    frees = free_count;
+    stats->failed_allocs = failed_allocs;
+    stats->heap_used = (size_t)(heap_ptr - my_heap);
+    spin_unlock_irqrestore(&heap_lock, flags);
+
+    /* Magazine counts are read without their owners' IRQs masked: a snapshot */
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        CoreCache *cc = &core_cache[cpu];
+        for (size_t c = 0; c < MAG_CLASSES; c++) {
+            cached_blocks += cc->count[c];
+            cached_units += cc->count[c] * (c + MAG_MIN_UNITS);
+        }
+        allocs += cc->allocs;
+        frees += cc->frees;
+        hits += cc->allocs;
+    }
+
+    stats->heap_size = HEAP_SIZE;
+    stats->free_bytes = free_units * sizeof(Header);
+    stats->largest_free = largest * sizeof(Header);
+    stats->free_blocks = blocks;
+    stats->cached_bytes = cached_units * sizeof(Header);
+    stats->cached_blocks = cached_blocks;
+    stats->used_blocks = allocs - frees;
+    stats->alloc_count = allocs;
+    stats->free_count = frees;
+    stats->cache_hits = hits;
+}
+
+#ifdef MEM_CALLSITE_STATS
+size_t mem_get_callsites(MemCallsite_t *out, size_t max) {
+    size_t n = 0;
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    for (int i = 0; i < MEM_CALLSITE_SLOTS && n < max; i++) {
+        if (callsites[i].allocs > 0)
+            out[n++] = callsites[i];
+    }
+    spin_unlock_irqrestore(&heap_lock, flags);
+    return n;
+}
+#endif
@@ -0,0 +1,176 @@
+#include "mpmc.h"
+#include "scheduler.h"
+#include "atomic.h"
+
+/* Weak symbol — overridden by real implementation on bare-metal */
+__attribute__((weak)) void task_yield(void) { }
+
+int mpmc_init(MPMC_t *q, size_t capacity) {
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0 || capacity > 0x80000000u)
+        return -1;
+    q->cells = (MpmcCell_t *)my_malloc_flags(capacity * sizeof(MpmcCell_t),
+                                             MEM_CACHE_ALIGNED);
+    if (!q->cells)
+        return -1;
+    for (uint32_t i = 0; i < capacity; i++)
+        q->cells[i].seq = i;
+    q->mask = (uint32_t)capacity - 1;
+    q->enqueue_pos = 0;
+    q->dequeue_pos = 0;
+    spin_lock_init(&q->lock);
+    q->producers_waiting = 0;
+    q->consumers_waiting = 0;
+    q->waitingProducers = NULL;
+    q->waitingConsumers = NULL;
+    return 0;
+}
+
+void mpmc_destroy(MPMC_t *q) {
+    if (q->cells)
+        my_free(q->cells);
+    q->cells = NULL;
+}
+
+/*
+ * A cell whose sequence equals the enqueue position is free; one whose
+ * sequence is position + 1 holds data. The consumer hands the cell back
+ * to the producer one lap later by storing position + capacity.
+ */
+static int enqueue(MPMC_t *q, uintptr_t item) {
+    uint32_t pos = atomic_read(&q->enqueue_pos);
+    for (;;) {
+        MpmcCell_t *cell = &q->cells[pos & q->mask];
+        int32_t diff = (int32_t)(atomic_read(&cell->seq) - pos);
+        if (diff == 0) {
+            if (atomic_cmpxchg(&q->enqueue_pos, pos, pos + 1)) {
+                cell->data = item;
+                atomic_set(&cell->seq, pos + 1);
+                return 0;
+            }
+        } else if (diff < 0) {
+            return -1;
+        }
+        /* Lost the race or saw a stale position: reload and retry */
+        pos = atomic_read(&q->enqueue_pos);
+    }
+}
+
+static int dequeue(MPMC_t *q, uintptr_t *item) {
+    uint32_t pos = atomic_read(&q->dequeue_pos);
+    for (;;) {
+        MpmcCell_t *cell = &q->cells[pos & q->mask];
+        int32_t diff = (int32_t)(atomic_read(&cell->seq) - (pos + 1));
+        if (diff == 0) {
+            if (atomic_cmpxchg(&q->dequeue_pos, pos, pos + 1)) {
+                *item = cell->data;
+                atomic_set(&cell->seq, pos + q->mask + 1);
+                return 0;
+            }
+        } else if (diff < 0) {
+            return -1;
+        }
+        pos = atomic_read(&q->dequeue_pos);
+    }
+}
+
+static void wake_one(MPMC_t *q, TCB_t **list, volatile uint32_t *waiting) {
+    uint32_t flags = spin_lock_irqsave(&q->lock);
+    TCB_t *task = *list;
+    if (task) {
+        *list = task->next;
+        task->next = NULL;
+        atomic_sub_return(waiting, 1);
+        scheduler_add_task(task);
+    }
+    spin_unlock_irqrestore(&q->lock, flags);
+}
+
+static void block_current(TCB_t **list, volatile uint32_t *waiting) {
+    current_tcb->state = TASK_STATE_BLOCKED;
+    current_tcb->next = *list;
+    *list = current_tcb;
+    /* Full barrier: the count must be visible before the recheck */
+    atomic_add_return(waiting, 1);
+}
+
+static void unblock_current(TCB_t **list, volatile uint32_t *waiting) {
+    /* Still at the head: the lock has been held since block_current */
+    *list = current_tcb->next;
+    current_tcb->next = NULL;
+    current_tcb->state = TASK_STATE_RUNNING;
+    atomic_sub_return(waiting, 1);
+}
+
+/* The barrier pairs with the one in block_current */
+static void wake_consumer(MPMC_t *q) {
+    smp_mb();
+    if (atomic_read(&q->consumers_waiting))
+        wake_one(q, &q->waitingConsumers, &q->consumers_waiting);
+}
+
+static void wake_producer(MPMC_t *q) {
+    smp_mb();
+    if (atomic_read(&q->producers_waiting))
+        wake_one(q, &q->waitingProducers, &q->producers_waiting);
+}
+
+int mpmc_try_push(MPMC_t *q, uintptr_t item) {
+    if (enqueue(q, item) != 0)
+        return -1;
+    wake_consumer(q);
+    return 0;
+}
+
+int mpmc_try_pop(MPMC_t *q, uintptr_t *item) {
+    if (dequeue(q, item) != 0)
+        return -1;
+    wake_producer(q);
+    return 0;
+}
+
+int mpmc_push(MPMC_t *q, uintptr_t item) {
+    for (;;) {
+        if (mpmc_try_push(q, item) == 0)
+            return 0;
+
+        uint32_t flags = spin_lock_irqsave(&q->lock);
+        block_current(&q->waitingProducers, &q->producers_waiting);
+        /* A consumer may have freed a cell before it could see us waiting */
+        if (enqueue(q, item) == 0) {
+            unblock_current(&q->waitingProducers, &q->producers_waiting);
+            spin_unlock_irqrestore(&q->lock, flags);
+            wake_consumer(q);
+            return 0;
+        }
+        spin_unlock_irqrestore(&q->lock, flags);
+        task_yield();
+        /* Resumed without a wake-up */
+        if (current_tcb->state == TASK_STATE_BLOCKED)
+            return -1;
+        /* Woken, but another producer may have taken the cell: retry */
+    }
+}
+
+int mpmc_pop(MPMC_t *q, uintptr_t *item) {
+    for (;;) {
+        if (mpmc_try_pop(q, item) == 0)
+            return 0;
+
+        uint32_t flags = spin_lock_irqsave(&q->lock);
+        block_current(&q->waitingConsumers, &q->consumers_waiting);
+        if (dequeue(q, item) == 0) {
+            unblock_current(&q->waitingConsumers, &q->consumers_waiting);
+            spin_unlock_irqrestore(&q->lock, flags);
+            wake_producer(q);
+            return 0;
+        }
+        spin_unlock_irqrestore(&q->lock, flags);
+        task_yield();
+        if (current_tcb->state == TASK_STATE_BLOCKED)
+            return -1;
+    }
+}
+
+size_t mpmc_count(const MPMC_t *q) {
+    return atomic_read(&q->enqueue_pos) - atomic_read(&q->dequeue_pos);
+}
@@ -1,41 +1,517 @@
 #include "mq.h"
 #include "mem.h"
+#include "kernel.h"
+#include "semaphore.h"
+#include "irq.h"
+#include "atomic.h"
+
+/* Weak symbols — overridden by real implementation on bare-metal */
+__attribute__((weak)) int task_create(TaskFunction_t func, uint8_t priority) {
+    (void)func;
+    (void)priority;
+    return -1;
+}
+
+__attribute__((weak)) void task_yield(void) { }
+
+typedef struct {
+    MQ_t *queue;
+    void *message;
+    bool held;          /* a MsgBuf_t reference owned by this entry */
+} Dispatch_t;
+
+static Dispatch_t *dispatch_ring;
+static size_t dispatch_capacity;
+static size_t dispatch_head;
+static size_t dispatch_count;
+static Semaphore_t dispatch_ready;
 
 void mq_init(MQ_t *queue) {
     queue->subscribers = NULL;
+    queue->mode = MQ_SYNC;
+    queue->pinning = 0;
+    queue->retired = NULL;
+    spin_lock_init(&queue->update_lock);
+    queue->retained = NULL;
+    queue->msgbuf = false;
+}
+
+static void free_retired(MQ_t *queue) {
+    while (queue->retired) {
+        SubscriberSet_t *set = queue->retired;
+        queue->retired = set->next_retired;
+        my_free(set);
+    }
+}
+
+void mq_destroy(MQ_t *queue) {
+    mq_clear_retained(queue);
+    free_retired(queue);
+    if (queue->subscribers)
+        my_free(queue->subscribers);
+    queue->subscribers = NULL;
+}
+
+void mq_set_mode(MQ_t *queue, MQMode_t mode) {
+    queue->mode = mode;
+}
+
+void mq_set_msgbuf(MQ_t *queue, bool msgbuf) {
+    queue->msgbuf = msgbuf;
+}
+
+/*
+ * Free each retired snapshot that no publish is walking. Called with
+ * update_lock held. A publish between reading the snapshot pointer and
+ * counting itself in users holds pinning up, so nothing is freed under
+ * it; once pinning reads zero, every publish on a retired snapshot is
+ * visible in that snapshot's users.
+ */
+static void reclaim_unused(MQ_t *queue) {
+    if (atomic_read(&queue->pinning))
+        return;
+    SubscriberSet_t **link = &queue->retired;
+    while (*link) {
+        SubscriberSet_t *set = *link;
+        if (atomic_read(&set->users)) {
+            link = &set->next_retired;
+        } else {
+            *link = set->next_retired;
+            my_free(set);
+        }
+    }
+}
+
+/*
+ * Swap in a new snapshot (NULL for none) and retire the old one. Called
+ * with update_lock held. The exchange is a full barrier, so a publish
+ * that starts pinning after reclaim_unused reads pinning sees the new
+ * snapshot.
+ */
+static void replace_set(MQ_t *queue, SubscriberSet_t *set) {
+    SubscriberSet_t *old = (SubscriberSet_t *)
+        atomic_xchg_ptr((void *volatile *)&queue->subscribers, set);
+    if (old) {
+        old->next_retired = queue->retired;
+        queue->retired = old;
+    }
+    reclaim_unused(queue);
+}
+
+/* Entries and their filters share one allocation: entries[] then filters[] */
+static SubscriberSet_t *alloc_set(size_t count) {
+    SubscriberSet_t *set = (SubscriberSet_t *)my_malloc(
+        sizeof(SubscriberSet_t) +
+        count * (sizeof(Subscriber_t) + sizeof(MQFilter_t)));
+    if (set) {
+        set->count = count;
+        set->users = 0;
+        set->filtered = 0;
+        set->next_retired = NULL;
+        set->filters = (MQFilter_t *)(set->entries + count);
+    }
+    return set;
+}
+
+/* Copy entries [from, from + n) of old to position to in set */
+static void copy_entries(SubscriberSet_t *set, size_t to,
+                         const SubscriberSet_t *old, size_t from, size_t n) {
+    rt_memcpy(set->entries + to, old->entries + from, n * sizeof(Subscriber_t));
+    rt_memcpy(set->filters + to, old->filters + from, n * sizeof(MQFilter_t));
+    for (size_t i = 0; i < n; i++)
+        if (old->filters[from + i].mask)
+            set->filtered++;
+}
+
+static bool filter_valid(const MQFilter_t *f) {
+    if (f->size != 1 && f->size != 2 && f->size != 4)
+        return false;
+    if (f->size < 4 && (f->mask >> (f->size * 8)))
+        return false;
+    /* Bits outside the mask could never match */
+    return (f->value & ~f->mask) == 0;
+}
+
+static uint32_t load_field(const uint8_t *msg, const MQFilter_t *f) {
+    switch (f->size) {
+    case 1:
+        return msg[f->offset];
+    case 2: {
+        uint16_t v;
+        rt_memcpy(&v, msg + f->offset, sizeof(v));
+        return v;
+    }
+    default: {
+        uint32_t v;
+        rt_memcpy(&v, msg + f->offset, sizeof(v));
+        return v;
+    }
+    }
+}
+
+/*
+ * Evaluate up to 32 filters into a bitmask of subscribers to call. The
+ * loop makes no calls, so all the compares run back to back before any
+ * callback. Unfiltered entries (mask 0, value 0) skip the load and
+ * always match.
+ */
+static uint32_t match_filters(const MQFilter_t *f, size_t n, const void *message) {
+    const uint8_t *msg = (const uint8_t *)message;
+    uint32_t bits = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t field = f[i].mask ? load_field(msg, &f[i]) : 0;
+        bits |= (uint32_t)((field & f[i].mask) == f[i].value) << i;
+    }
+    return bits;
+}
+
+/* The bytes filters read: the payload of a MsgBuf_t, else the message */
+static const void *filter_fields(const MQ_t *queue, void *message) {
+    return queue->msgbuf ? ((MsgBuf_t *)message)->data : message;
 }
 
 int mq_subscribe(MQ_t *queue, MessageCallback_t callback, void *context) {
-    if (!callback)
+    return mq_subscribe_filtered(queue, callback, context, NULL);
+}
+
+int mq_subscribe_filtered(MQ_t *queue, MessageCallback_t callback,
+                          void *context, const MQFilter_t *filter) {
+    if (!callback || (filter && !filter_valid(filter)))
         return -1;
-    CallbackNode *node = (CallbackNode *)my_malloc(sizeof(CallbackNode));
-    if (!node)
+    uint32_t flags = spin_lock_irqsave(&queue->update_lock);
+    SubscriberSet_t *old = queue->subscribers;
+    size_t n = old ? old->count : 0;
+    SubscriberSet_t *set = alloc_set(n + 1);
+    if (!set) {
+        spin_unlock_irqrestore(&queue->update_lock, flags);
+        return -1;
+    }
+    if (n)
+        copy_entries(set, 0, old, 0, n);
+    set->entries[n].callback = callback;
+    set->entries[n].context = context;
+    if (filter && filter->mask) {
+        set->filters[n] = *filter;
+        set->filtered++;
+    } else {
+        rt_memset(&set->filters[n], 0, sizeof(MQFilter_t));
+    }
+    MQFilter_t f = set->filters[n];
+    replace_set(queue, set);
+    /* Hold our own reference so a concurrent replace can't free it */
+    MsgBuf_t *retained = queue->retained;
+    if (retained)
+        msgbuf_retain(retained);
+    spin_unlock_irqrestore(&queue->update_lock, flags);
+
+    if (retained) {
+        if (match_filters(&f, 1, retained->data))
+            callback(retained, context);
+        msgbuf_release(retained);
+    }
+    return 0;
+}
+
+/*
+ * Remove an entry by swapping in a snapshot without it. If replaced is
+ * not NULL the caller also counts as a user of the old snapshot,
+ * returned there, which stays allocated until the caller drops users.
+ */
+static int remove_subscriber(MQ_t *queue, MessageCallback_t callback,
+                             void *context, SubscriberSet_t **replaced) {
+    uint32_t flags = spin_lock_irqsave(&queue->update_lock);
+    SubscriberSet_t *old = queue->subscribers;
+    size_t n = old ? old->count : 0;
+    size_t i = 0;
+    while (i < n && (old->entries[i].callback != callback ||
+                     old->entries[i].context != context))
+        i++;
+    if (i == n) {
+        spin_unlock_irqrestore(&queue->update_lock, flags);
         return -1;
-    node->callback = callback;
-    node->context = context;
-    node->next = queue->subscribers;
-    queue->subscribers = node;
+    }
+
+    SubscriberSet_t *set = NULL;
+    if (n > 1) {
+        set = alloc_set(n - 1);
+        if (!set) {
+            spin_unlock_irqrestore(&queue->update_lock, flags);
+            return -1;
+        }
+        copy_entries(set, 0, old, 0, i);
+        copy_entries(set, i, old, i + 1, n - i - 1);
+    }
+    if (replaced) {
+        /* Still current, so it cannot have been freed */
+        atomic_add_return(&old->users, 1);
+        *replaced = old;
+    }
+    replace_set(queue, set);
+    spin_unlock_irqrestore(&queue->update_lock, flags);
     return 0;
 }
 
 int mq_unsubscribe(MQ_t *queue, MessageCallback_t callback, void *context) {
-    CallbackNode **prev = &queue->subscribers;
-    while (*prev) {
-        CallbackNode *curr = *prev;
-        if (curr->callback == callback && curr->context == context) {
-            *prev = curr->next;
-            my_free(curr);
-            return 0;
+    return remove_subscriber(queue, callback, context, NULL);
+}
+
+int mq_publish_retained(MQ_t *queue, MsgBuf_t *mb) {
+    if (!queue->msgbuf)
+        return -1;
+    msgbuf_retain(mb);
+    uint32_t flags = spin_lock_irqsave(&queue->update_lock);
+    MsgBuf_t *old = queue->retained;
+    queue->retained = mb;
+    spin_unlock_irqrestore(&queue->update_lock, flags);
+    if (old)
+        msgbuf_release(old);
+    return mq_publish(queue, mb);
+}
+
+void mq_clear_retained(MQ_t *queue) {
+    uint32_t flags = spin_lock_irqsave(&queue->update_lock);
+    MsgBuf_t *old = queue->retained;
+    queue->retained = NULL;
+    spin_unlock_irqrestore(&queue->update_lock, flags);
+    if (old)
+        msgbuf_release(old);
+}
+
+void mq_reclaim(MQ_t *queue) {
+    uint32_t flags = spin_lock_irqsave(&queue->update_lock);
+    reclaim_unused(queue);
+    spin_unlock_irqrestore(&queue->update_lock, flags);
+}
+
+/*
+ * Take the current snapshot and count this publish as one of its users.
+ * The pin only counts if the snapshot is still current afterwards, so
+ * anyone who swapped it out and then reads users cannot miss us. Only
+ * this short window, not the callbacks, holds pinning up.
+ */
+static SubscriberSet_t *pin_set(MQ_t *queue) {
+    SubscriberSet_t *set;
+    atomic_add_return(&queue->pinning, 1);
+    for (;;) {
+        set = (SubscriberSet_t *)
+            atomic_read_ptr((void *const volatile *)&queue->subscribers);
+        if (!set)
+            break;
+        atomic_add_return(&set->users, 1);
+        if (atomic_read_ptr((void *const volatile *)&queue->subscribers) == set)
+            break;
+        atomic_sub_return(&set->users, 1);
+    }
+    atomic_sub_return(&queue->pinning, 1);
+    return set;
+}
+
+static void deliver(MQ_t *queue, void *message) {
+    SubscriberSet_t *set = pin_set(queue);
+    if (set && set->filtered == 0) {
+        const Subscriber_t *s = set->entries;
+        for (size_t i = 0; i < set->count; i++)
+            s[i].callback(message, s[i].context);
+    } else if (set) {
+        const void *fields = filter_fields(queue, message);
+        for (size_t base = 0; base < set->count; base += 32) {
+            size_t n = set->count - base;
+            if (n > 32)
+                n = 32;
+            const Subscriber_t *s = set->entries + base;
+            uint32_t match = match_filters(set->filters + base, n, fields);
+            while (match) {
+                uint32_t i = (uint32_t)__builtin_ctz(match);
+                match &= match - 1;
+                s[i].callback(message, s[i].context);
+            }
         }
-        prev = &curr->next;
     }
-    return -1;
+    if (set)
+        atomic_sub_return(&set->users, 1);
+}
+
+/* Drop the reference a queued MsgBuf_t held */
+static void put_queued(const MQSubQueue_t *sq, void *message) {
+    if (sq->msgbuf)
+        msgbuf_release((MsgBuf_t *)message);
+}
+
+static void queue_callback(void *message, void *context) {
+    MQSubQueue_t *sq = (MQSubQueue_t *)context;
+    void *evicted;
+    /* Being unsubscribed: queue nothing more, and never block on it */
+    if (atomic_read(&sq->closing))
+        return;
+    if (sq->msgbuf)
+        msgbuf_retain((MsgBuf_t *)message);
+    switch (sq->policy) {
+    case MQ_DROP_NEWEST:
+        if (ipc_try_send(&sq->ipc, message) < 0) {
+            atomic_add_return(&sq->dropped, 1);
+            put_queued(sq, message);
+        }
+        break;
+    case MQ_DROP_OLDEST:
+        if (ipc_send_overwrite(&sq->ipc, message, &evicted) > 0) {
+            atomic_add_return(&sq->dropped, 1);
+            put_queued(sq, evicted);
+        }
+        break;
+    case MQ_BLOCK:
+        /* Fails only if resumed without room; that is a drop too */
+        if (ipc_send(&sq->ipc, message) < 0) {
+            atomic_add_return(&sq->dropped, 1);
+            put_queued(sq, message);
+        }
+        break;
+    }
+}
+
+static void discard_queued(MQSubQueue_t *sq) {
+    void *message;
+    while (ipc_try_receive(&sq->ipc, &message) == 0)
+        put_queued(sq, message);
+}
+
+/*
+ * Any publish still walking old (we hold one pin on it ourselves) or a
+ * snapshot retired before it. Those are the ones that can list sq.
+ */
+static bool snapshots_in_use(MQ_t *queue, const SubscriberSet_t *old) {
+    uint32_t flags = spin_lock_irqsave(&queue->update_lock);
+    reclaim_unused(queue);
+    bool busy = atomic_read(&old->users) > 1 || old->next_retired;
+    spin_unlock_irqrestore(&queue->update_lock, flags);
+    return busy;
 }
 
-void mq_publish(MQ_t *queue, void *message) {
-    CallbackNode *curr = queue->subscribers;
-    while (curr) {
-        curr->callback(message, curr->context);
-        curr = curr->next;
+int mq_subscribe_queue(MQ_t *queue, MQSubQueue_t *sq, size_t capacity,
+                       MQOverflow_t policy, const MQFilter_t *filter) {
+    if (capacity == 0 || policy > MQ_BLOCK)
+        return -1;
+    if (ipc_init(&sq->ipc, capacity) < 0)
+        return -1;
+    sq->policy = policy;
+    sq->dropped = 0;
+    sq->closing = 0;
+    sq->msgbuf = queue->msgbuf;
+    if (mq_subscribe_filtered(queue, queue_callback, sq, filter) < 0) {
+        ipc_destroy(&sq->ipc);
+        return -1;
     }
+    return 0;
+}
+
+int mq_unsubscribe_queue(MQ_t *queue, MQSubQueue_t *sq) {
+    SubscriberSet_t *old;
+    if (remove_subscriber(queue, queue_callback, sq, &old) < 0)
+        return -1;
+    atomic_set(&sq->closing, 1);
+    smp_mb();
+    /*
+     * Only publishes that pinned a snapshot listing sq can still reach
+     * it; later ones see none. Draining wakes any of them blocked on
+     * the full queue, so the wait is bounded whatever else is published.
+     */
+    while (snapshots_in_use(queue, old)) {
+        discard_queued(sq);
+        task_yield();
+    }
+    discard_queued(sq);
+    ipc_destroy(&sq->ipc);
+    atomic_sub_return(&old->users, 1);
+    mq_reclaim(queue);
+    return 0;
+}
+
+int mq_queue_receive(MQSubQueue_t *sq, void **message) {
+    return ipc_receive(&sq->ipc, message);
+}
+
+int mq_queue_try_receive(MQSubQueue_t *sq, void **message) {
+    return ipc_try_receive(&sq->ipc, message);
+}
+
+static int enqueue_dispatch(MQ_t *queue, void *message, bool held) {
+    uint32_t flags = irq_disable();
+    if (dispatch_count == dispatch_capacity) {
+        irq_restore(flags);
+        return -1;
+    }
+    size_t tail = dispatch_head + dispatch_count;
+    if (tail >= dispatch_capacity)
+        tail -= dispatch_capacity;
+    dispatch_ring[tail].queue = queue;
+    dispatch_ring[tail].message = message;
+    dispatch_ring[tail].held = held;
+    /* Only the first entry needs to wake the dispatcher; it drains them all */
+    bool was_empty = dispatch_count++ == 0;
+    irq_restore(flags);
+    if (was_empty)
+        semaphore_signal(&dispatch_ready);
+    return 0;
+}
+
+int mq_publish(MQ_t *queue, void *message) {
+    if (queue->mode == MQ_SYNC) {
+        deliver(queue, message);
+        return 0;
+    }
+    if (!queue->msgbuf)
+        return enqueue_dispatch(queue, message, false);
+    /* The queued entry keeps the buffer alive until it is delivered */
+    msgbuf_retain((MsgBuf_t *)message);
+    if (enqueue_dispatch(queue, message, true) < 0) {
+        msgbuf_release((MsgBuf_t *)message);
+        return -1;
+    }
+    return 0;
+}
+
+int mq_dispatcher_init(size_t capacity) {
+    if (capacity == 0)
+        return -1;
+    dispatch_ring = (Dispatch_t *)my_malloc(capacity * sizeof(Dispatch_t));
+    if (!dispatch_ring)
+        return -1;
+    dispatch_capacity = capacity;
+    dispatch_head = 0;
+    dispatch_count = 0;
+    semaphore_init(&dispatch_ready, 0);
+    return 0;
+}
+
+size_t mq_dispatch_pending(void) {
+    size_t n = 0;
+    for (;;) {
+        uint32_t flags = irq_disable();
+        if (dispatch_count == 0) {
+            irq_restore(flags);
+            return n;
+        }
+        Dispatch_t d = dispatch_ring[dispatch_head];
+        if (++dispatch_head == dispatch_capacity)
+            dispatch_head = 0;
+        dispatch_count--;
+        irq_restore(flags);
+        /* Callbacks run with IRQs enabled, in task context */
+        deliver(d.queue, d.message);
+        if (d.held)
+            msgbuf_release((MsgBuf_t *)d.message);
+        n++;
+    }
+}
+
+static void dispatcher_task(void) {
+    for (;;) {
+        semaphore_wait(&dispatch_ready);
+        mq_dispatch_pending();
+    }
+}
+
+int mq_dispatcher_start(uint8_t priority) {
+    if (!dispatch_ring)
+        return -1;
+    return task_create(dispatcher_task, priority) < 0 ? -1 : 0;
 }
@@ -0,0 +1,103 @@
+#include "msgbuf.h"
+#include "mem.h"
+#include "atomic.h"
+
+/* Headers are cache-line aligned so refcount updates on one buffer do not
+ * bounce the line holding its neighbour's */
+#define MSGBUF_HDR_SIZE \
+    ((sizeof(MsgBuf_t) + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1))
+
+static uint8_t *buf_start(const MsgBuf_t *mb) {
+    return (uint8_t *)mb + MSGBUF_HDR_SIZE;
+}
+
+static uint8_t *buf_end(const MsgBuf_t *mb) {
+    return buf_start(mb) + mb->pool->headroom + mb->pool->size;
+}
+
+int msgpool_init(MsgPool_t *pool, size_t count, size_t size, size_t headroom) {
+    if (count == 0 || size == 0)
+        return -1;
+    pool->stride = (MSGBUF_HDR_SIZE + headroom + size + CACHE_LINE_SIZE - 1) &
+                   ~(size_t)(CACHE_LINE_SIZE - 1);
+    pool->memory = (uint8_t *)my_malloc_flags(count * pool->stride, MEM_CACHE_ALIGNED);
+    if (!pool->memory)
+        return -1;
+    pool->size = size;
+    pool->headroom = headroom;
+    pool->count = count;
+    pool->available = count;
+    spin_lock_init(&pool->lock);
+    pool->free = NULL;
+    for (size_t i = count; i-- > 0; ) {
+        MsgBuf_t *mb = (MsgBuf_t *)(pool->memory + i * pool->stride);
+        mb->pool = pool;
+        mb->refs = 0;
+        mb->next_free = pool->free;
+        pool->free = mb;
+    }
+    return 0;
+}
+
+void msgpool_destroy(MsgPool_t *pool) {
+    if (pool->memory)
+        my_free(pool->memory);
+    pool->memory = NULL;
+    pool->free = NULL;
+}
+
+MsgBuf_t *msgbuf_alloc(MsgPool_t *pool) {
+    uint32_t flags = spin_lock_irqsave(&pool->lock);
+    MsgBuf_t *mb = pool->free;
+    if (mb) {
+        pool->free = mb->next_free;
+        pool->available--;
+    }
+    spin_unlock_irqrestore(&pool->lock, flags);
+    if (!mb)
+        return NULL;
+    mb->next_free = NULL;
+    mb->data = buf_start(mb) + pool->headroom;
+    mb->len = 0;
+    atomic_set(&mb->refs, 1);
+    return mb;
+}
+
+void msgbuf_retain(MsgBuf_t *mb) {
+    atomic_add_return(&mb->refs, 1);
+}
+
+void msgbuf_release(MsgBuf_t *mb) {
+    if (atomic_sub_return(&mb->refs, 1) != 0)
+        return;
+    MsgPool_t *pool = mb->pool;
+    uint32_t flags = spin_lock_irqsave(&pool->lock);
+    mb->next_free = pool->free;
+    pool->free = mb;
+    pool->available++;
+    spin_unlock_irqrestore(&pool->lock, flags);
+}
+
+uint8_t *msgbuf_put(MsgBuf_t *mb, size_t n) {
+    uint8_t *tail = mb->data + mb->len;
+    if (n > (size_t)(buf_end(mb) - tail))
+        return NULL;
+    mb->len += n;
+    return tail;
+}
+
+uint8_t *msgbuf_push(MsgBuf_t *mb, size_t n) {
+    if (n > (size_t)(mb->data - buf_start(mb)))
+        return NULL;
+    mb->data -= n;
+    mb->len += n;
+    return mb->data;
+}
+
+uint8_t *msgbuf_pull(MsgBuf_t *mb, size_t n) {
+    if (n > mb->len)
+        return NULL;
+    mb->data += n;
+    mb->len -= n;
+    return mb->data;
+}
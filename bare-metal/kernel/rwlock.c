@@ -0,0 +1,238 @@
+#include "rwlock.h"
+#include "scheduler.h"
+#include "atomic.h"
+
+/* Weak symbol — overridden by real implementation on bare-metal */
+__attribute__((weak)) void task_yield(void) { }
+
+void rwlock_init(RWLock_t *rw) {
+    rw->state = 0;
+    spin_lock_init(&rw->lock);
+    rw->readers_waiting = NULL;
+    rw->writers_waiting = NULL;
+    rw->upgrader = NULL;
+}
+
+/* Highest priority first, FIFO within a level */
+static void enqueue(TCB_t **list, TCB_t *task) {
+    TCB_t **link = list;
+    while (*link && (*link)->priority <= task->priority)
+        link = &(*link)->next;
+    task->next = *link;
+    *link = task;
+}
+
+static void dequeue(TCB_t **list, TCB_t *task) {
+    TCB_t **link = list;
+    while (*link && *link != task)
+        link = &(*link)->next;
+    if (*link)
+        *link = task->next;
+    task->next = NULL;
+}
+
+static void wake_all(TCB_t *list) {
+    while (list) {
+        TCB_t *task = list;
+        list = task->next;
+        task->next = NULL;
+        task->state = TASK_STATE_READY;
+        scheduler_add_task(task);
+    }
+}
+
+static uint32_t waiters_bit(const RWLock_t *rw) {
+    return (rw->readers_waiting || rw->writers_waiting || rw->upgrader)
+        ? RWLOCK_WAITERS : 0;
+}
+
+/*
+ * Detach the queued readers that rank above every queued writer (all of
+ * them if no writer waits). The queue is sorted, so they are a prefix.
+ */
+static TCB_t *take_readers(RWLock_t *rw, uint32_t *count) {
+    TCB_t *writer = rw->writers_waiting;
+    TCB_t **link = &rw->readers_waiting;
+    uint32_t n = 0;
+    while (*link && (!writer || (*link)->priority < writer->priority)) {
+        link = &(*link)->next;
+        n++;
+    }
+    TCB_t *granted = rw->readers_waiting;
+    rw->readers_waiting = *link;
+    *link = NULL;
+    *count = n;
+    return n ? granted : NULL;
+}
+
+/*
+ * Hand a free lock (no readers, no writer) to its waiters. Called with the
+ * spinlock held and RWLOCK_WAITERS set, so no fast path can change state
+ * meanwhile. The new state is published before anyone is woken, because
+ * on SMP a woken reader may run and unlock straight away.
+ */
+static void hand_off(RWLock_t *rw) {
+    TCB_t *granted;
+    uint32_t state;
+    TCB_t *w = rw->writers_waiting;
+    TCB_t *r = rw->readers_waiting;
+    if (rw->upgrader) {
+        granted = rw->upgrader;
+        granted->next = NULL;
+        rw->upgrader = NULL;
+        state = RWLOCK_WRITER;
+    } else if (w && (!r || w->priority <= r->priority)) {
+        granted = w;
+        rw->writers_waiting = w->next;
+        w->next = NULL;
+        state = RWLOCK_WRITER;
+    } else {
+        granted = take_readers(rw, &state);
+    }
+    atomic_set(&rw->state, state | waiters_bit(rw));
+    wake_all(granted);
+}
+
+/*
+ * Under the spinlock: set RWLOCK_WAITERS unless the lock can be taken
+ * right away, in which case take it (reader or writer) and return true.
+ */
+static bool take_or_mark(RWLock_t *rw, bool writer) {
+    for (;;) {
+        uint32_t c = atomic_read(&rw->state);
+        bool free = writer ? c == 0 : !(c & (RWLOCK_WRITER | RWLOCK_WAITERS));
+        if (free) {
+            if (atomic_cmpxchg(&rw->state, c, writer ? RWLOCK_WRITER : c + 1))
+                return true;
+            continue;
+        }
+        if ((c & RWLOCK_WAITERS) ||
+            atomic_cmpxchg(&rw->state, c, c | RWLOCK_WAITERS))
+            return false;
+    }
+}
+
+/*
+ * Block the current task, already queued, until a release hands it the
+ * lock. Entered with the spinlock held. A task resumed without the lock
+ * leaves its queue (list, or the upgrader slot if NULL) and returns -1.
+ */
+static int block(RWLock_t *rw, TCB_t **list, uint32_t flags) {
+    current_tcb->state = TASK_STATE_BLOCKED;
+    spin_unlock_irqrestore(&rw->lock, flags);
+    task_yield();
+
+    flags = spin_lock_irqsave(&rw->lock);
+    if (current_tcb->state != TASK_STATE_BLOCKED) {
+        spin_unlock_irqrestore(&rw->lock, flags);
+        return 0;
+    }
+    if (list)
+        dequeue(list, current_tcb);
+    else
+        rw->upgrader = NULL;
+    current_tcb->state = TASK_STATE_RUNNING;
+    uint32_t c = atomic_read(&rw->state);
+    if (!(c & (RWLOCK_READERS | RWLOCK_WRITER)))
+        hand_off(rw);
+    else if (!waiters_bit(rw))
+        atomic_sub_return(&rw->state, RWLOCK_WAITERS);
+    spin_unlock_irqrestore(&rw->lock, flags);
+    return -1;
+}
+
+bool rwlock_try_read_lock(RWLock_t *rw) {
+    uint32_t c = atomic_read(&rw->state);
+    while (!(c & (RWLOCK_WRITER | RWLOCK_WAITERS))) {
+        if (atomic_cmpxchg(&rw->state, c, c + 1))
+            return true;
+        c = atomic_read(&rw->state);
+    }
+    return false;
+}
+
+bool rwlock_try_write_lock(RWLock_t *rw) {
+    return atomic_cmpxchg(&rw->state, 0, RWLOCK_WRITER);
+}
+
+int rwlock_read_lock(RWLock_t *rw) {
+    if (rwlock_try_read_lock(rw))
+        return 0;
+    uint32_t flags = spin_lock_irqsave(&rw->lock);
+    if (take_or_mark(rw, false)) {
+        spin_unlock_irqrestore(&rw->lock, flags);
+        return 0;
+    }
+    enqueue(&rw->readers_waiting, current_tcb);
+    return block(rw, &rw->readers_waiting, flags);
+}
+
+int rwlock_write_lock(RWLock_t *rw) {
+    if (rwlock_try_write_lock(rw))
+        return 0;
+    uint32_t flags = spin_lock_irqsave(&rw->lock);
+    if (take_or_mark(rw, true)) {
+        spin_unlock_irqrestore(&rw->lock, flags);
+        return 0;
+    }
+    enqueue(&rw->writers_waiting, current_tcb);
+    return block(rw, &rw->writers_waiting, flags);
+}
+
+void rwlock_read_unlock(RWLock_t *rw) {
+    uint32_t c = atomic_sub_return(&rw->state, 1);
+    if ((c & RWLOCK_READERS) || !(c & RWLOCK_WAITERS))
+        return;
+    /* Last reader out with tasks queued */
+    uint32_t flags = spin_lock_irqsave(&rw->lock);
+    c = atomic_read(&rw->state);
+    if (!(c & (RWLOCK_READERS | RWLOCK_WRITER)) && (c & RWLOCK_WAITERS))
+        hand_off(rw);
+    spin_unlock_irqrestore(&rw->lock, flags);
+}
+
+void rwlock_write_unlock(RWLock_t *rw) {
+    if (atomic_cmpxchg(&rw->state, RWLOCK_WRITER, 0))
+        return;
+    uint32_t flags = spin_lock_irqsave(&rw->lock);
+    hand_off(rw);
+    spin_unlock_irqrestore(&rw->lock, flags);
+}
+
+int rwlock_upgrade(RWLock_t *rw) {
+    /* Sole reader and nobody waiting */
+    if (atomic_cmpxchg(&rw->state, 1, RWLOCK_WRITER))
+        return 0;
+    uint32_t flags = spin_lock_irqsave(&rw->lock);
+    if (rw->upgrader) {
+        spin_unlock_irqrestore(&rw->lock, flags);
+        return -1;
+    }
+    for (;;) {
+        uint32_t c = atomic_read(&rw->state);
+        if ((c & RWLOCK_READERS) == 1) {
+            if (atomic_cmpxchg(&rw->state, c, RWLOCK_WRITER | (c & RWLOCK_WAITERS))) {
+                spin_unlock_irqrestore(&rw->lock, flags);
+                return 0;
+            }
+            continue;
+        }
+        /* Give up our read hold and wait for the others to leave */
+        if (atomic_cmpxchg(&rw->state, c, (c - 1) | RWLOCK_WAITERS))
+            break;
+    }
+    rw->upgrader = current_tcb;
+    /* The read hold is gone: resumed without the lock, we hold nothing */
+    return block(rw, NULL, flags) < 0 ? -2 : 0;
+}
+
+void rwlock_downgrade(RWLock_t *rw) {
+    if (atomic_cmpxchg(&rw->state, RWLOCK_WRITER, 1))
+        return;
+    uint32_t flags = spin_lock_irqsave(&rw->lock);
+    uint32_t n;
+    TCB_t *granted = take_readers(rw, &n);
+    atomic_set(&rw->state, (n + 1) | waiters_bit(rw));
+    wake_all(granted);
+    spin_unlock_irqrestore(&rw->lock, flags);
+}
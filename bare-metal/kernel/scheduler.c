@@ -90,6 +90,19 @@ void scheduler_remove_task(TCB_t *tcb) {
     }
 }
 
+/* Change a task's effective priority, moving it between ready queues */
+void scheduler_set_priority(TCB_t *tcb, uint8_t priority) {
+    if (tcb->priority == priority)
+        return;
+    if (tcb->state == TASK_STATE_READY) {
+        scheduler_remove_task(tcb);
+        tcb->priority = priority;
+        enqueue_ready(tcb);
+    } else {
+        tcb->priority = priority;
+    }
+}
+
 TCB_t *scheduler_select_next(void) {
     for (int p = 0; p < MAX_PRIORITIES; p++) {
         TCB_t *next = dequeue_ready((uint8_t)p);
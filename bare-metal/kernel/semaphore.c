@@ -1,38 +1,82 @@
 #include "semaphore.h"
 #include "scheduler.h"
-#include "irq.h"
+#include "atomic.h"
 
 /* Weak symbol — overridden by real implementation on bare-metal */
 __attribute__((weak)) void task_yield(void) { }
 
+static inline volatile uint32_t *count_word(Semaphore_t *sem) {
+    return (volatile uint32_t *)&sem->count;
+}
+
 void semaphore_init(Semaphore_t *sem, int init_val) {
     sem->count = init_val;
     sem->waiting = NULL;
+    spin_lock_init(&sem->lock);
 }
 
+/*
+ * The count only goes negative under the lock, with the waiter queued in
+ * the same critical section, so "count < 0" and "waiting != NULL" agree
+ * whenever the lock is free. The fast paths never cross zero.
+ */
 void semaphore_wait(Semaphore_t *sem) {
-    uint32_t flags = irq_disable();
-    sem->count--;
-    if (sem->count < 0) {
+    int c = (int)atomic_read(count_word(sem));
+    while (c > 0) {
+        if (atomic_cmpxchg(count_word(sem), (uint32_t)c, (uint32_t)(c - 1)))
+            return;
+        c = (int)atomic_read(count_word(sem));
+    }
+
+    uint32_t flags = spin_lock_irqsave(&sem->lock);
+    if ((int)atomic_sub_return(count_word(sem), 1) < 0) {
         current_tcb->state = TASK_STATE_BLOCKED;
         current_tcb->next = sem->waiting;
         sem->waiting = current_tcb;
-        irq_restore(flags);
+        spin_unlock_irqrestore(&sem->lock, flags);
         task_yield();
     } else {
-        irq_restore(flags);
+        spin_unlock_irqrestore(&sem->lock, flags);
     }
 }
 
+bool semaphore_enqueue_if_held(Semaphore_t *sem, TCB_t *task) {
+    uint32_t flags = spin_lock_irqsave(&sem->lock);
+    /* A fast-path signal may race the decrement, so it must be a CAS */
+    int c;
+    do {
+        c = (int)atomic_read(count_word(sem));
+        if (c > 0) {
+            spin_unlock_irqrestore(&sem->lock, flags);
+            return false;
+        }
+    } while (!atomic_cmpxchg(count_word(sem), (uint32_t)c, (uint32_t)(c - 1)));
+    /* By priority, behind equals, so a broadcast hands out in order */
+    TCB_t **link = &sem->waiting;
+    while (*link && (*link)->priority <= task->priority)
+        link = &(*link)->next;
+    task->next = *link;
+    *link = task;
+    spin_unlock_irqrestore(&sem->lock, flags);
+    return true;
+}
+
 void semaphore_signal(Semaphore_t *sem) {
-    uint32_t flags = irq_disable();
-    sem->count++;
-    if (sem->waiting != NULL) {
+    int c = (int)atomic_read(count_word(sem));
+    while (c >= 0) {
+        if (atomic_cmpxchg(count_word(sem), (uint32_t)c, (uint32_t)(c + 1)))
+            return;
+        c = (int)atomic_read(count_word(sem));
+    }
+
+    uint32_t flags = spin_lock_irqsave(&sem->lock);
+    /* The old value was negative, so a waiter is queued */
+    if ((int)atomic_add_return(count_word(sem), 1) <= 0) {
         TCB_t *task = sem->waiting;
         sem->waiting = task->next;
         task->next = NULL;
         task->state = TASK_STATE_READY;
         scheduler_add_task(task);
     }
-    irq_restore(flags);
+    spin_unlock_irqrestore(&sem->lock, flags);
 }
@@ -0,0 +1,110 @@
+#include "spsc.h"
+#include "scheduler.h"
+#include "atomic.h"
+#include "irq.h"
+
+/* Weak symbol — overridden by real implementation on bare-metal */
+__attribute__((weak)) void task_yield(void) { }
+
+int spsc_init(SPSC_t *r, size_t capacity) {
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0 || capacity > 0x80000000u)
+        return -1;
+    r->buffer = (uintptr_t *)my_malloc_flags(capacity * sizeof(uintptr_t),
+                                             MEM_CACHE_ALIGNED);
+    if (!r->buffer)
+        return -1;
+    r->mask = (uint32_t)capacity - 1;
+    r->head = 0;
+    r->tail_cache = 0;
+    r->tail = 0;
+    r->head_cache = 0;
+    r->waiter = NULL;
+    r->notify = NULL;
+    r->notify_ctx = NULL;
+    return 0;
+}
+
+void spsc_destroy(SPSC_t *r) {
+    if (r->buffer)
+        my_free(r->buffer);
+    r->buffer = NULL;
+}
+
+void spsc_set_notify(SPSC_t *r, SpscNotify_t notify, void *context) {
+    r->notify_ctx = context;
+    r->notify = notify;
+}
+
+int spsc_push(SPSC_t *r, uintptr_t item) {
+    uint32_t head = r->head;
+    if (head - r->tail_cache > r->mask) {
+        /* Looks full: refresh the consumer's index once */
+        r->tail_cache = atomic_read(&r->tail);
+        if (head - r->tail_cache > r->mask)
+            return -1;
+    }
+    r->buffer[head & r->mask] = item;
+    atomic_set(&r->head, head + 1);
+
+    if (r->notify)
+        r->notify(r->notify_ctx);
+
+    /* Full barrier: the head store must be visible before reading waiter */
+    smp_mb();
+    if (r->waiter) {
+        /* The ready queues are not IRQ-safe: a task-level push masks IRQs */
+        uint32_t flags = irq_disable();
+        TCB_t *task = (TCB_t *)atomic_xchg_ptr((void *volatile *)&r->waiter, NULL);
+        if (task)
+            scheduler_add_task(task);
+        irq_restore(flags);
+    }
+    return 0;
+}
+
+int spsc_pop(SPSC_t *r, uintptr_t *item) {
+    uint32_t tail = r->tail;
+    if (tail == r->head_cache) {
+        r->head_cache = atomic_read(&r->head);
+        if (tail == r->head_cache)
+            return -1;
+    }
+    *item = r->buffer[tail & r->mask];
+    atomic_set(&r->tail, tail + 1);
+    return 0;
+}
+
+int spsc_pop_wait(SPSC_t *r, uintptr_t *item) {
+    if (spsc_pop(r, item) == 0)
+        return 0;
+
+    /*
+     * Mark ourselves blocked before publishing the waiter so a producer
+     * on another core cannot make us ready before we block, then recheck
+     * to close the window against a push that raced with the pop.
+     */
+    uint32_t flags = irq_disable();
+    current_tcb->state = TASK_STATE_BLOCKED;
+    atomic_set_ptr((void *volatile *)&r->waiter, current_tcb);
+    smp_mb();
+    if (atomic_read(&r->head) != r->tail &&
+        atomic_xchg_ptr((void *volatile *)&r->waiter, NULL) == current_tcb) {
+        current_tcb->state = TASK_STATE_RUNNING;
+        irq_restore(flags);
+        return spsc_pop(r, item);
+    }
+    irq_restore(flags);
+    task_yield();
+    if (current_tcb->state == TASK_STATE_BLOCKED) {
+        /* Resumed without a push: withdraw, unless a producer just took us */
+        flags = irq_disable();
+        if (atomic_cmpxchg_ptr((void *volatile *)&r->waiter, current_tcb, NULL))
+            current_tcb->state = TASK_STATE_RUNNING;
+        irq_restore(flags);
+    }
+    return spsc_pop(r, item);
+}
+
+size_t spsc_count(const SPSC_t *r) {
+    return atomic_read(&r->head) - atomic_read(&r->tail);
+}
@@ -0,0 +1,133 @@
+#include "stream.h"
+#include "mem.h"
+#include "scheduler.h"
+#include "irq.h"
+
+/* Weak symbol — overridden by real implementation on bare-metal */
+__attribute__((weak)) void task_yield(void) { }
+
+int stream_init(Stream_t *s, size_t size) {
+    if (size == 0)
+        return -1;
+    s->buffer = (uint8_t *)my_malloc(size);
+    if (!s->buffer)
+        return -1;
+    s->size = size;
+    s->head = 0;
+    s->tail = 0;
+    s->count = 0;
+    s->trigger = 0;
+    s->reader = NULL;
+    s->writer = NULL;
+    return 0;
+}
+
+void stream_destroy(Stream_t *s) {
+    if (s->buffer)
+        my_free(s->buffer);
+    s->buffer = NULL;
+}
+
+static void wake(TCB_t **slot) {
+    TCB_t *task = *slot;
+    *slot = NULL;
+    task->state = TASK_STATE_READY;
+    scheduler_add_task(task);
+}
+
+/* Copy in as much as fits, as at most two contiguous runs */
+static size_t ring_write(Stream_t *s, const uint8_t *data, size_t len) {
+    size_t n = s->size - s->count;
+    if (n > len)
+        n = len;
+    size_t first = s->size - s->tail;
+    if (first > n)
+        first = n;
+    rt_memcpy(s->buffer + s->tail, data, first);
+    rt_memcpy(s->buffer, data + first, n - first);
+    s->tail += n;
+    if (s->tail >= s->size)
+        s->tail -= s->size;
+    s->count += n;
+    if (s->reader && s->count >= s->trigger)
+        wake(&s->reader);
+    return n;
+}
+
+static size_t ring_read(Stream_t *s, uint8_t *buf, size_t maxlen) {
+    size_t n = s->count < maxlen ? s->count : maxlen;
+    size_t first = s->size - s->head;
+    if (first > n)
+        first = n;
+    rt_memcpy(buf, s->buffer + s->head, first);
+    rt_memcpy(buf + first, s->buffer, n - first);
+    s->head += n;
+    if (s->head >= s->size)
+        s->head -= s->size;
+    s->count -= n;
+    if (s->writer && n > 0)
+        wake(&s->writer);
+    return n;
+}
+
+size_t stream_write(Stream_t *s, const void *data, size_t len) {
+    const uint8_t *src = (const uint8_t *)data;
+    size_t done = 0;
+    uint32_t flags = irq_disable();
+    while (done < len) {
+        done += ring_write(s, src + done, len - done);
+        if (done == len)
+            break;
+        s->writer = current_tcb;
+        current_tcb->state = TASK_STATE_BLOCKED;
+        irq_restore(flags);
+        task_yield();
+        flags = irq_disable();
+        if (s->count == s->size) {
+            /* Still full: woken for another reason */
+            if (s->writer == current_tcb)
+                s->writer = NULL;
+            break;
+        }
+    }
+    irq_restore(flags);
+    return done;
+}
+
+size_t stream_try_write(Stream_t *s, const void *data, size_t len) {
+    uint32_t flags = irq_disable();
+    size_t n = ring_write(s, (const uint8_t *)data, len);
+    irq_restore(flags);
+    return n;
+}
+
+size_t stream_read(Stream_t *s, void *buf, size_t maxlen, size_t trigger_level) {
+    if (maxlen == 0)
+        return 0;
+    /* A trigger above what can ever be returned would never fire */
+    if (trigger_level == 0)
+        trigger_level = 1;
+    if (trigger_level > maxlen)
+        trigger_level = maxlen;
+    if (trigger_level > s->size)
+        trigger_level = s->size;
+
+    uint32_t flags = irq_disable();
+    if (s->count < trigger_level) {
+        s->trigger = trigger_level;
+        s->reader = current_tcb;
+        current_tcb->state = TASK_STATE_BLOCKED;
+        irq_restore(flags);
+        task_yield();
+        flags = irq_disable();
+        if (s->reader == current_tcb)
+            s->reader = NULL;
+    }
+    size_t n = ring_read(s, (uint8_t *)buf, maxlen);
+    irq_restore(flags);
+    return n;
+}
+
+size_t stream_available(const Stream_t *s) {
+    return s->count;
+}
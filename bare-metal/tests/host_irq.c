@@ -0,0 +1,10 @@
+#include "irq.h"
+
+/*
+ * Host builds have no real IRQs or cores. Weak, so a test that counts
+ * IRQ sections (or pretends to be another core) can define its own.
+ */
+__attribute__((weak)) uint32_t irq_disable(void) { return 0; }
+__attribute__((weak)) void irq_restore(uint32_t flags) { (void)flags; }
+__attribute__((weak)) void irq_enable(void) { }
+__attribute__((weak)) uint32_t cpu_id(void) { return 0; }
@@ -0,0 +1,79 @@
+#define _GNU_SOURCE
+#include "host_tasks.h"
+#include "scheduler.h"
+#include <ucontext.h>
+
+#define HOST_STACK_SIZE (64 * 1024)
+
+static ucontext_t main_ctx;
+static ucontext_t task_ctx[MAX_TASKS];
+static TaskFunction_t task_func[MAX_TASKS];
+static char task_stack[MAX_TASKS][HOST_STACK_SIZE];
+
+uint32_t host_context_switches;
+
+static int task_index(const TCB_t *tcb) {
+    return (int)(tcb - scheduler_get_task_pool());
+}
+
+void task_exit(void) {
+    current_tcb->state = TASK_STATE_DEAD;
+    task_yield();
+}
+
+static void task_entry(void) {
+    task_func[task_index(current_tcb)]();
+    task_exit();
+}
+
+void task_yield(void) {
+    TCB_t *old = current_tcb;
+    if (old->state == TASK_STATE_RUNNING)
+        scheduler_add_task(old);
+    TCB_t *next = scheduler_select_next();
+    if (next == old) {
+        if (old->state == TASK_STATE_RUNNING)
+            return;
+        /* Nothing runnable: hand control back to host_tasks_run */
+        swapcontext(&task_ctx[task_index(old)], &main_ctx);
+        return;
+    }
+    host_context_switches++;
+    swapcontext(&task_ctx[task_index(old)], &task_ctx[task_index(next)]);
+}
+
+void host_tasks_init(void) {
+    scheduler_init();
+    host_context_switches = 0;
+}
+
+TCB_t *host_task_create(TaskFunction_t func, uint8_t priority) {
+    TCB_t *tcb = scheduler_alloc_task();
+    if (!tcb)
+        return NULL;
+    int i = task_index(tcb);
+    tcb->priority = priority;
+    tcb->base_priority = priority;
+    tcb->delay_ticks = 0;
+    tcb->message = NULL;
+    tcb->sp = NULL;
+    tcb->stack_base = NULL;
+    task_func[i] = func;
+    getcontext(&task_ctx[i]);
+    task_ctx[i].uc_stack.ss_sp = task_stack[i];
+    task_ctx[i].uc_stack.ss_size = HOST_STACK_SIZE;
+    task_ctx[i].uc_link = NULL;
+    makecontext(&task_ctx[i], task_entry, 0);
+    scheduler_add_task(tcb);
+    return tcb;
+}
+
+void host_tasks_run(void) {
+    for (;;) {
+        current_tcb = NULL;
+        TCB_t *next = scheduler_select_next();
+        if (!next)
+            return;
+        swapcontext(&main_ctx, &task_ctx[task_index(next)]);
+    }
+}
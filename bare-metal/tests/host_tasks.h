@@ -0,0 +1,24 @@
+#ifndef HOST_TASKS_H
+#define HOST_TASKS_H
+
+#include "kernel.h"
+
+/*
+ * Host task harness: runs kernel tasks as ucontext coroutines on the real
+ * scheduler, so blocking primitives can be exercised end to end without
+ * the ARM context switch. Provides task_yield and task_exit; link it in
+ * place of a stub. Tasks only switch when they yield or block.
+ */
+
+void host_tasks_init(void);
+TCB_t *host_task_create(TaskFunction_t func, uint8_t priority);
+void task_yield(void);
+void task_exit(void);
+
+/* Run until no task is ready (all finished or all blocked) */
+void host_tasks_run(void);
+
+/* Task-to-task switches since host_tasks_init */
+extern uint32_t host_context_switches;
+
+#endif /* HOST_TASKS_H */
@@ -0,0 +1,162 @@
+#include "unity.h"
+#include "broker.h"
+#include "mem.h"
+
+static Broker_t broker;
+static int calls;
+static void *last_message;
+
+static void count_callback(void *message, void *context) {
+    (void)context;
+    calls++;
+    last_message = message;
+}
+
+void setUp(void) {
+    init_allocator();
+    mq_dispatcher_init(4);
+    broker_init(&broker, 8);
+    calls = 0;
+    last_message = NULL;
+}
+
+void tearDown(void) {
+    broker_destroy(&broker);
+}
+
+void test_init_sizes_table_to_half_load(void) {
+    TEST_ASSERT_EQUAL_UINT(15, broker.mask);
+    TEST_ASSERT_EQUAL_UINT(0, broker.count);
+}
+
+void test_numeric_topic_created_once(void) {
+    MQ_t *a = broker_topic(&broker, 42);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_EQUAL_PTR(a, broker_topic(&broker, 42));
+    TEST_ASSERT_EQUAL_PTR(a, broker_find(&broker, 42));
+    TEST_ASSERT_NULL(broker_find(&broker, 43));
+    TEST_ASSERT_EQUAL_UINT(1, broker.count);
+}
+
+void test_named_topic_created_once(void) {
+    MQ_t *t = broker_topic_named(&broker, "sensor/temp");
+    TEST_ASSERT_NOT_NULL(t);
+    TEST_ASSERT_EQUAL_PTR(t, broker_topic_named(&broker, "sensor/temp"));
+    TEST_ASSERT_NULL(broker_find_named(&broker, "sensor/tem"));
+    TEST_ASSERT_NULL(broker_find_named(&broker, "sensor/temp2"));
+}
+
+void test_named_and_numeric_topics_distinct(void) {
+    MQ_t *n = broker_topic(&broker, 1);
+    MQ_t *s = broker_topic_named(&broker, "1");
+    TEST_ASSERT_NOT_EQUAL(n, s);
+}
+
+void test_publish_by_id_and_name(void) {
+    mq_subscribe(broker_topic(&broker, 7), count_callback, NULL);
+    mq_subscribe(broker_topic_named(&broker, "ctl"), count_callback, NULL);
+    int m1, m2;
+    TEST_ASSERT_EQUAL_INT(0, broker_publish(&broker, 7, &m1));
+    TEST_ASSERT_EQUAL_PTR(&m1, last_message);
+    TEST_ASSERT_EQUAL_INT(0, broker_publish_named(&broker, "ctl", &m2));
+    TEST_ASSERT_EQUAL_PTR(&m2, last_message);
+    TEST_ASSERT_EQUAL_INT(-1, broker_publish(&broker, 8, &m1));
+    TEST_ASSERT_EQUAL_INT(2, calls);
+}
+
+void test_registry_full_returns_null(void) {
+    for (uint32_t i = 0; i < 8; i++)
+        TEST_ASSERT_NOT_NULL(broker_topic(&broker, i * 16));
+    TEST_ASSERT_NULL(broker_topic(&broker, 999));
+    /* Every topic is still reachable through its probe sequence */
+    for (uint32_t i = 0; i < 8; i++)
+        TEST_ASSERT_NOT_NULL(broker_find(&broker, i * 16));
+}
+
+void test_name_too_long_rejected(void) {
+    char name[BROKER_NAME_LEN + 1];
+    rt_memset(name, 'x', BROKER_NAME_LEN);
+    name[BROKER_NAME_LEN] = '\0';
+    TEST_ASSERT_NULL(broker_topic_named(&broker, name));
+}
+
+void test_prefix_subscription_covers_existing_and_new_topics(void) {
+    broker_topic_named(&broker, "sensor/temp");
+    broker_topic_named(&broker, "motor/speed");
+    TEST_ASSERT_EQUAL_INT(0, broker_subscribe_prefix(&broker, "sensor/",
+                                                     count_callback, NULL));
+    broker_topic_named(&broker, "sensor/humidity");
+
+    int m;
+    broker_publish_named(&broker, "sensor/temp", &m);
+    broker_publish_named(&broker, "sensor/humidity", &m);
+    broker_publish_named(&broker, "motor/speed", &m);
+    TEST_ASSERT_EQUAL_INT(2, calls);
+}
+
+/* Take every block the heap can hand out, linked through their first word */
+static void *hog;
+
+static void exhaust_heap(void) {
+    hog = NULL;
+    for (size_t size = 4096; size >= sizeof(void *); size /= 2) {
+        void *p;
+        while ((p = my_malloc(size)) != NULL) {
+            *(void **)p = hog;
+            hog = p;
+        }
+    }
+}
+
+static void release_heap(void) {
+    while (hog) {
+        void *next = *(void **)hog;
+        my_free(hog);
+        hog = next;
+    }
+}
+
+void test_prefix_subscription_failure_registers_nothing(void) {
+    broker_topic_named(&broker, "sensor/temp");
+    exhaust_heap();
+    TEST_ASSERT_EQUAL_INT(-1, broker_subscribe_prefix(&broker, "sensor/",
+                                                      count_callback, NULL));
+    release_heap();
+    TEST_ASSERT_EQUAL_UINT(0, broker.wildcard_count);
+
+    int m;
+    broker_topic_named(&broker, "sensor/humidity");
+    broker_publish_named(&broker, "sensor/temp", &m);
+    broker_publish_named(&broker, "sensor/humidity", &m);
+    TEST_ASSERT_EQUAL_INT(0, calls);
+}
+
+void test_named_topic_not_created_without_its_prefix_subscribers(void) {
+    broker_subscribe_prefix(&broker, "sensor/", count_callback, NULL);
+    exhaust_heap();
+    TEST_ASSERT_NULL(broker_topic_named(&broker, "sensor/temp"));
+    release_heap();
+    TEST_ASSERT_NULL(broker_find_named(&broker, "sensor/temp"));
+    TEST_ASSERT_EQUAL_UINT(0, broker.count);
+
+    /* Retrying once memory is back creates it with the subscription */
+    TEST_ASSERT_NOT_NULL(broker_topic_named(&broker, "sensor/temp"));
+    int m;
+    broker_publish_named(&broker, "sensor/temp", &m);
+    TEST_ASSERT_EQUAL_INT(1, calls);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_init_sizes_table_to_half_load);
+    RUN_TEST(test_numeric_topic_created_once);
+    RUN_TEST(test_named_topic_created_once);
+    RUN_TEST(test_named_and_numeric_topics_distinct);
+    RUN_TEST(test_publish_by_id_and_name);
+    RUN_TEST(test_registry_full_returns_null);
+    RUN_TEST(test_name_too_long_rejected);
+    RUN_TEST(test_prefix_subscription_covers_existing_and_new_topics);
+    RUN_TEST(test_prefix_subscription_failure_registers_nothing);
+    RUN_TEST(test_named_topic_not_created_without_its_prefix_subscribers);
+    return UNITY_END();
+}
@@ -0,0 +1,254 @@
+#include "unity.h"
+#include "cond.h"
+#include "scheduler.h"
+#include "host_tasks.h"
+
+/* Host stubs */
+uint32_t irq_disable(void) { return 0; }
+void irq_restore(uint32_t flags) { (void)flags; }
+
+static CondVar_t cv;
+static Semaphore_t mutex;
+static char order[16];
+static int logged;
+static bool ready;
+static int rc;
+
+static void log_event(char c) {
+    order[logged++] = c;
+    order[logged] = '\0';
+}
+
+void setUp(void) {
+    host_tasks_init();
+    cond_init(&cv);
+    semaphore_init(&mutex, 1);
+    logged = 0;
+    order[0] = '\0';
+    ready = false;
+    rc = 1;
+}
+
+void tearDown(void) {
+}
+
+static void waiter(void) {
+    semaphore_wait(&mutex);
+    while (!ready)
+        rc = cond_wait(&cv, &mutex);
+    /* Holds the mutex again */
+    log_event(mutex.count == 0 ? 'w' : 'x');
+    semaphore_signal(&mutex);
+}
+
+static void setter(void) {
+    semaphore_wait(&mutex);
+    ready = true;
+    log_event('s');
+    cond_signal(&cv);
+    semaphore_signal(&mutex);
+}
+
+void test_signal_wakes_waiter_with_mutex(void) {
+    host_task_create(waiter, 1);
+    host_task_create(setter, 2);
+    host_tasks_run();
+    TEST_ASSERT_EQUAL_STRING("sw", order);
+    TEST_ASSERT_EQUAL_INT(0, rc);
+    TEST_ASSERT_EQUAL_INT(1, mutex.count);
+    TEST_ASSERT_NULL(cv.waiting);
+}
+
+static void signal_early(void) {
+    cond_signal(&cv);
+    log_event('s');
+}
+
+void test_signal_without_waiters_is_not_remembered(void) {
+    host_task_create(signal_early, 1);
+    host_task_create(waiter, 2);
+    host_tasks_run();
+    /* The waiter blocked for good: nobody signalled after it waited */
+    TEST_ASSERT_EQUAL_STRING("s", order);
+    TEST_ASSERT_NOT_NULL(cv.waiting);
+}
+
+static void waiter_logs_priority(void) {
+    semaphore_wait(&mutex);
+    cond_wait(&cv, &mutex);
+    log_event((char)('0' + current_tcb->priority));
+    semaphore_signal(&mutex);
+}
+
+static void queue_waiters_then_signal(void) {
+    static const uint8_t prio[] = { 3, 1, 2 };
+    for (int i = 0; i < 3; i++) {
+        host_task_create(waiter_logs_priority, prio[i]);
+        task_yield();
+    }
+    for (int i = 0; i < 3; i++) {
+        cond_signal(&cv);
+        task_yield();
+    }
+}
+
+void test_signal_wakes_highest_priority_first(void) {
+    host_task_create(queue_waiters_then_signal, 5);
+    host_tasks_run();
+    TEST_ASSERT_EQUAL_STRING("123", order);
+}
+
+static void queue_waiters_then_broadcast(void) {
+    static const uint8_t prio[] = { 3, 1, 2 };
+    for (int i = 0; i < 3; i++) {
+        host_task_create(waiter_logs_priority, prio[i]);
+        task_yield();
+    }
+    cond_broadcast(&cv);
+}
+
+void test_broadcast_wakes_all(void) {
+    host_task_create(queue_waiters_then_broadcast, 5);
+    host_tasks_run();
+    TEST_ASSERT_EQUAL_INT(3, logged);
+    TEST_ASSERT_NULL(cv.waiting);
+    TEST_ASSERT_EQUAL_INT(1, mutex.count);
+}
+
+static void queue_waiters_then_broadcast_holding_mutex(void) {
+    static const uint8_t prio[] = { 3, 1, 2 };
+    for (int i = 0; i < 3; i++) {
+        host_task_create(waiter_logs_priority, prio[i]);
+        task_yield();
+    }
+    semaphore_wait(&mutex);
+    /* All three move to the held mutex and get it one at a time */
+    cond_broadcast(&cv);
+    semaphore_signal(&mutex);
+}
+
+void test_broadcast_holding_mutex_hands_out_by_priority(void) {
+    host_task_create(queue_waiters_then_broadcast_holding_mutex, 5);
+    host_tasks_run();
+    TEST_ASSERT_EQUAL_STRING("123", order);
+    TEST_ASSERT_EQUAL_INT(1, mutex.count);
+}
+
+static TCB_t *waiter_task;
+
+static void signal_holding_mutex(void) {
+    semaphore_wait(&mutex);
+    ready = true;
+    cond_signal(&cv);
+    /* Still holding the mutex: the waiter must not be scheduled yet */
+    task_yield();
+    log_event(waiter_task->state == TASK_STATE_BLOCKED ? 'b' : 'r');
+    semaphore_signal(&mutex);
+}
+
+void test_waiter_moved_to_held_mutex(void) {
+    waiter_task = host_task_create(waiter, 1);
+    host_task_create(signal_holding_mutex, 2);
+    host_tasks_run();
+    TEST_ASSERT_EQUAL_STRING("bw", order);
+    /* Into the signaller, then into the waiter once it owns the mutex */
+    TEST_ASSERT_EQUAL_UINT32(2, host_context_switches);
+}
+
+/*
+ * --- bounded buffer: wait until N items, semaphore loop vs condvar ---
+ * Both producers notify only once a batch is ready, and both are
+ * preempted once inside the critical section, so the difference is what
+ * the condvar does with a waiter signalled while the mutex is held.
+ */
+
+#define BATCH   4
+#define BATCHES 8
+
+static Semaphore_t changed;
+static int items;
+static int consumed;
+
+static void sem_consumer(void) {
+    for (int b = 0; b < BATCHES; b++) {
+        semaphore_wait(&mutex);
+        while (items < BATCH) {
+            semaphore_signal(&mutex);
+            semaphore_wait(&changed);
+            semaphore_wait(&mutex);
+        }
+        items -= BATCH;
+        consumed += BATCH;
+        semaphore_signal(&mutex);
+    }
+}
+
+static void cond_consumer(void) {
+    for (int b = 0; b < BATCHES; b++) {
+        semaphore_wait(&mutex);
+        while (items < BATCH)
+            cond_wait(&cv, &mutex);
+        items -= BATCH;
+        consumed += BATCH;
+        semaphore_signal(&mutex);
+    }
+}
+
+static void notify_sem(void) {
+    semaphore_signal(&changed);
+}
+
+static void notify_cond(void) {
+    cond_signal(&cv);
+}
+
+static void (*notify)(void);
+
+static void producer(void) {
+    for (int i = 0; i < BATCH * BATCHES; i++) {
+        semaphore_wait(&mutex);
+        if (++items >= BATCH)
+            notify();
+        /* Preempted before the unlock */
+        task_yield();
+        semaphore_signal(&mutex);
+        task_yield();
+    }
+}
+
+static uint32_t run_bounded_buffer(TaskFunction_t consumer, void (*fn)(void)) {
+    setUp();
+    semaphore_init(&changed, 0);
+    items = 0;
+    consumed = 0;
+    notify = fn;
+    host_task_create(consumer, 1);
+    host_task_create(producer, 2);
+    host_tasks_run();
+    TEST_ASSERT_EQUAL_INT(BATCH * BATCHES, consumed);
+    return host_context_switches;
+}
+
+void test_bounded_buffer_fewer_switches_than_semaphore_loop(void) {
+    uint32_t sem_switches = run_bounded_buffer(sem_consumer, notify_sem);
+    uint32_t cond_switches = run_bounded_buffer(cond_consumer, notify_cond);
+    /*
+     * The woken semaphore consumer runs at the in-lock yield only to
+     * block on the mutex and switch back: two extra switches per batch.
+     * The condvar moves it onto the held mutex instead.
+     */
+    TEST_ASSERT_EQUAL_UINT32(1 + 4 * BATCHES, sem_switches);
+    TEST_ASSERT_EQUAL_UINT32(1 + 2 * BATCHES, cond_switches);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_signal_wakes_waiter_with_mutex);
+    RUN_TEST(test_signal_without_waiters_is_not_remembered);
+    RUN_TEST(test_signal_wakes_highest_priority_first);
+    RUN_TEST(test_broadcast_wakes_all);
+    RUN_TEST(test_broadcast_holding_mutex_hands_out_by_priority);
+    RUN_TEST(test_waiter_moved_to_held_mutex);
+    RUN_TEST(test_bounded_buffer_fewer_switches_than_semaphore_loop);
+    return UNITY_END();
+}
@@ -0,0 +1,173 @@
+#include "unity.h"
+#include "futex.h"
+#include "atomic.h"
+#include "scheduler.h"
+#include "host_tasks.h"
+
+/* Host stubs */
+uint32_t irq_disable(void) { return 0; }
+void irq_restore(uint32_t flags) { (void)flags; }
+
+static volatile uint32_t word;
+static volatile uint32_t other_word;
+static char order[16];
+static int logged;
+static int rc;
+
+static void log_event(char c) {
+    order[logged++] = c;
+    order[logged] = '\0';
+}
+
+void setUp(void) {
+    host_tasks_init();
+    word = 0;
+    other_word = 0;
+    logged = 0;
+    order[0] = '\0';
+    rc = 1;
+}
+
+void tearDown(void) {
+}
+
+static void wait_on_word(void) {
+    rc = futex_wait(&word, 0);
+    log_event((char)('0' + current_tcb->priority));
+}
+
+void test_wait_returns_at_once_if_value_changed(void) {
+    static TCB_t task;
+    task.state = TASK_STATE_RUNNING;
+    current_tcb = &task;
+    word = 1;
+    TEST_ASSERT_EQUAL_INT(-1, futex_wait(&word, 0));
+    TEST_ASSERT_EQUAL(TASK_STATE_RUNNING, task.state);
+}
+
+void test_wake_without_waiters(void) {
+    TEST_ASSERT_EQUAL_UINT32(0, futex_wake(&word, 1));
+}
+
+static void set_and_wake(void) {
+    atomic_set(&word, 1);
+    log_event('s');
+    futex_wake(&word, 1);
+}
+
+void test_wait_blocks_until_woken(void) {
+    host_task_create(wait_on_word, 1);
+    host_task_create(set_and_wake, 2);
+    host_tasks_run();
+    TEST_ASSERT_EQUAL_STRING("s1", order);
+    TEST_ASSERT_EQUAL_INT(0, rc);
+}
+
+static void queue_then_wake(void) {
+    static const uint8_t prio[] = { 3, 1, 2 };
+    for (int i = 0; i < 3; i++) {
+        host_task_create(wait_on_word, prio[i]);
+        task_yield();
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, futex_wake(&word, 2));
+    task_yield();
+    log_event('|');
+    TEST_ASSERT_EQUAL_UINT32(1, futex_wake(&word, 10));
+}
+
+void test_wake_n_highest_priority_first(void) {
+    host_task_create(queue_then_wake, 5);
+    host_tasks_run();
+    TEST_ASSERT_EQUAL_STRING("12|3", order);
+}
+
+static void wait_on_other(void) {
+    futex_wait(&other_word, 0);
+    log_event('o');
+}
+
+static void wake_word_only(void) {
+    host_task_create(wait_on_other, 1);
+    task_yield();
+    host_task_create(wait_on_word, 2);
+    task_yield();
+    /* Only the waiter on word; other_word's waiter stays queued */
+    TEST_ASSERT_EQUAL_UINT32(1, futex_wake(&word, 10));
+    task_yield();
+    TEST_ASSERT_EQUAL_UINT32(1, futex_wake(&other_word, 10));
+}
+
+void test_wake_matches_address(void) {
+    host_task_create(wake_word_only, 5);
+    host_tasks_run();
+    TEST_ASSERT_EQUAL_STRING("2o", order);
+}
+
+/* --- a three-state mutex built on the futex (0 free, 1 held, 2 contended) --- */
+
+static volatile uint32_t lock_word;
+static int kernel_entries;
+static int in_critical;
+static int max_in_critical;
+
+static void futex_mutex_lock(void) {
+    if (atomic_cmpxchg(&lock_word, 0, 1))
+        return;
+    while (atomic_xchg(&lock_word, 2) != 0) {
+        kernel_entries++;
+        futex_wait(&lock_word, 2);
+    }
+}
+
+static void futex_mutex_unlock(void) {
+    if (atomic_xchg(&lock_word, 0) == 2) {
+        kernel_entries++;
+        futex_wake(&lock_word, 1);
+    }
+}
+
+static void mutex_user(void) {
+    for (int i = 0; i < 3; i++) {
+        futex_mutex_lock();
+        if (++in_critical > max_in_critical)
+            max_in_critical = in_critical;
+        task_yield();
+        in_critical--;
+        futex_mutex_unlock();
+    }
+}
+
+void test_futex_mutex_uncontended_stays_in_user_code(void) {
+    lock_word = 0;
+    kernel_entries = 0;
+    for (int i = 0; i < 10; i++) {
+        futex_mutex_lock();
+        futex_mutex_unlock();
+    }
+    TEST_ASSERT_EQUAL_INT(0, kernel_entries);
+}
+
+void test_futex_mutex_excludes_under_contention(void) {
+    lock_word = 0;
+    kernel_entries = 0;
+    in_critical = 0;
+    max_in_critical = 0;
+    host_task_create(mutex_user, 2);
+    host_task_create(mutex_user, 2);
+    host_tasks_run();
+    TEST_ASSERT_EQUAL_INT(1, max_in_critical);
+    TEST_ASSERT_EQUAL_UINT32(0, lock_word);
+    TEST_ASSERT_TRUE(kernel_entries > 0);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_wait_returns_at_once_if_value_changed);
+    RUN_TEST(test_wake_without_waiters);
+    RUN_TEST(test_wait_blocks_until_woken);
+    RUN_TEST(test_wake_n_highest_priority_first);
+    RUN_TEST(test_wake_matches_address);
+    RUN_TEST(test_futex_mutex_uncontended_stays_in_user_code);
+    RUN_TEST(test_futex_mutex_excludes_under_contention);
+    return UNITY_END();
+}
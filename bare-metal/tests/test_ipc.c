@@ -3,12 +3,24 @@
 #include "mem.h"
 #include "scheduler.h"
 
-/* Host stubs */
+/* Host stubs; on_irq_restore runs once, standing in for an interrupt */
+static void (*on_irq_restore)(void);
 uint32_t irq_disable(void) { return 0; }
-void irq_restore(uint32_t flags) { (void)flags; }
+void irq_restore(uint32_t flags) {
+    (void)flags;
+    void (*fn)(void) = on_irq_restore;
+    on_irq_restore = NULL;
+    if (fn)
+        fn();
+}
 
 static int yield_called;
-void task_yield(void) { yield_called++; }
+static void (*on_yield)(void);
+void task_yield(void) {
+    yield_called++;
+    if (on_yield)
+        on_yield();
+}
 
 extern TCB_t *scheduler_get_task_pool(void);
 
@@ -32,6 +44,8 @@ void setUp(void) {
     init_allocator();
     scheduler_init();
     yield_called = 0;
+    on_yield = NULL;
+    on_irq_restore = NULL;
     ipc_init(&queue, 4);
     setup_current_task(1);
 }
@@ -128,6 +142,508 @@ void test_send_unblocks_consumer(void) {
     TEST_ASSERT_EQUAL(TASK_STATE_READY, consumer->state);
 }
 
+void test_try_send_full_fails_without_blocking(void) {
+    int m;
+    for (int i = 0; i < 4; i++)
+        TEST_ASSERT_EQUAL_INT(0, ipc_try_send(&queue, &m));
+    TEST_ASSERT_EQUAL_INT(-1, ipc_try_send(&queue, &m));
+    TEST_ASSERT_EQUAL_INT(0, yield_called);
+    TEST_ASSERT_EQUAL(TASK_STATE_RUNNING, current_tcb->state);
+    TEST_ASSERT_NULL(queue.waitingProducers);
+}
+
+void test_try_receive_empty_fails_without_blocking(void) {
+    void *out;
+    TEST_ASSERT_EQUAL_INT(-1, ipc_try_receive(&queue, &out));
+    TEST_ASSERT_EQUAL_INT(0, yield_called);
+    TEST_ASSERT_NULL(queue.waitingConsumers);
+
+    int m;
+    ipc_try_send(&queue, &m);
+    TEST_ASSERT_EQUAL_INT(0, ipc_try_receive(&queue, &out));
+    TEST_ASSERT_EQUAL_PTR(&m, out);
+}
+
+void test_send_overwrite_evicts_oldest(void) {
+    int m[6];
+    void *evicted;
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL_INT(0, ipc_send_overwrite(&queue, &m[i], &evicted));
+        TEST_ASSERT_NULL(evicted);
+    }
+    TEST_ASSERT_EQUAL_INT(1, ipc_send_overwrite(&queue, &m[4], &evicted));
+    TEST_ASSERT_EQUAL_PTR(&m[0], evicted);
+    TEST_ASSERT_EQUAL_INT(1, ipc_send_overwrite(&queue, &m[5], &evicted));
+    TEST_ASSERT_EQUAL_PTR(&m[1], evicted);
+    TEST_ASSERT_EQUAL_UINT(4, queue.count);
+
+    void *out;
+    for (int i = 2; i < 6; i++) {
+        ipc_receive(&queue, &out);
+        TEST_ASSERT_EQUAL_PTR(&m[i], out);
+    }
+    TEST_ASSERT_EQUAL_INT(0, yield_called);
+}
+
+void test_send_many_receive_many_order(void) {
+    int m[3] = {1, 2, 3};
+    void *msgs[3] = {&m[0], &m[1], &m[2]};
+    TEST_ASSERT_EQUAL_INT(3, ipc_send_many(&queue, msgs, 3));
+    TEST_ASSERT_EQUAL_UINT(3, queue.count);
+
+    void *out[4];
+    TEST_ASSERT_EQUAL_INT(3, ipc_receive_many(&queue, out, 4));
+    for (int i = 0; i < 3; i++)
+        TEST_ASSERT_EQUAL_PTR(msgs[i], out[i]);
+    TEST_ASSERT_EQUAL_UINT(0, queue.count);
+}
+
+void test_batch_wraps_around(void) {
+    int m[6];
+    void *msgs[6], *out[6];
+    for (int i = 0; i < 6; i++)
+        msgs[i] = &m[i];
+    /* Advance head/tail so the next batch straddles the end of the ring */
+    ipc_send_many(&queue, msgs, 3);
+    ipc_receive_many(&queue, out, 3);
+    TEST_ASSERT_EQUAL_INT(4, ipc_send_many(&queue, msgs + 2, 4));
+    TEST_ASSERT_EQUAL_INT(4, ipc_receive_many(&queue, out, 6));
+    for (int i = 0; i < 4; i++)
+        TEST_ASSERT_EQUAL_PTR(msgs[i + 2], out[i]);
+}
+
+void test_receive_many_takes_what_is_available(void) {
+    int a = 1, b = 2;
+    ipc_send(&queue, &a);
+    ipc_send(&queue, &b);
+    void *out[2];
+    TEST_ASSERT_EQUAL_INT(1, ipc_receive_many(&queue, out, 1));
+    TEST_ASSERT_EQUAL_PTR(&a, out[0]);
+    TEST_ASSERT_EQUAL_UINT(1, queue.count);
+}
+
+void test_receive_many_blocks_when_empty(void) {
+    TCB_t *task = setup_current_task(1);
+    void *out[4];
+    TEST_ASSERT_EQUAL_INT(0, ipc_receive_many(&queue, out, 4));
+    TEST_ASSERT_EQUAL_INT(1, yield_called);
+    TEST_ASSERT_EQUAL(TASK_STATE_BLOCKED, task->state);
+}
+
+/* The first message wakes us but another consumer takes it */
+static int stolen_msg[2];
+static void send_one_first_stolen(void) {
+    void *r;
+    ipc_try_send(&queue, &stolen_msg[yield_called - 1]);
+    if (yield_called == 1)
+        ipc_try_receive(&queue, &r);
+}
+
+void test_receive_many_blocks_again_when_woken_empty(void) {
+    setup_current_task(1);
+    on_yield = send_one_first_stolen;
+    void *out[4];
+    TEST_ASSERT_EQUAL_INT(1, ipc_receive_many(&queue, out, 4));
+    TEST_ASSERT_EQUAL_INT(2, yield_called);
+    TEST_ASSERT_EQUAL_PTR(&stolen_msg[1], out[0]);
+}
+
+void test_send_many_wakes_one_consumer_per_message(void) {
+    void *out[1];
+    TCB_t *c1 = setup_current_task(1);
+    ipc_receive_many(&queue, out, 1);
+    TCB_t *c2 = setup_current_task(1);
+    ipc_receive_many(&queue, out, 1);
+    TCB_t *c3 = setup_current_task(1);
+    ipc_receive_many(&queue, out, 1);
+
+    setup_current_task(1);
+    int m[2];
+    void *msgs[2] = {&m[0], &m[1]};
+    ipc_send_many(&queue, msgs, 2);
+    /* Waiters are LIFO, as with ipc_send */
+    TEST_ASSERT_EQUAL(TASK_STATE_READY, c3->state);
+    TEST_ASSERT_EQUAL(TASK_STATE_READY, c2->state);
+    TEST_ASSERT_EQUAL(TASK_STATE_BLOCKED, c1->state);
+}
+
+/* Free one slot per yield, but hand the first one to another producer */
+static void drain_one_first_stolen(void) {
+    void *r;
+    ipc_try_receive(&queue, &r);
+    if (yield_called == 1)
+        ipc_try_send(&queue, r);
+}
+
+void test_send_many_blocks_when_full(void) {
+    int m[6];
+    void *msgs[6];
+    for (int i = 0; i < 6; i++)
+        msgs[i] = &m[i];
+    setup_current_task(1);
+    on_yield = drain_one_first_stolen;
+    /* Four fit; woken with the queue still full, it blocks again */
+    TEST_ASSERT_EQUAL_INT(6, ipc_send_many(&queue, msgs, 6));
+    TEST_ASSERT_EQUAL_INT(3, yield_called);
+    void *r;
+    static const int expect[] = { 3, 0, 4, 5 };
+    for (int i = 0; i < 4; i++) {
+        ipc_try_receive(&queue, &r);
+        TEST_ASSERT_EQUAL_PTR(&m[expect[i]], r);
+    }
+}
+
+static IPCWatermark_t events[8];
+static int event_count;
+
+static void record_watermark(IPC_t *q, IPCWatermark_t event, void *context) {
+    (void)q;
+    (*(int *)context)++;
+    if (event_count < 8)
+        events[event_count++] = event;
+}
+
+void test_peak_depth_tracked(void) {
+    int m;
+    void *out;
+    ipc_send(&queue, &m);
+    ipc_send(&queue, &m);
+    ipc_send(&queue, &m);
+    ipc_receive(&queue, &out);
+    ipc_receive(&queue, &out);
+    ipc_send(&queue, &m);
+    TEST_ASSERT_EQUAL_UINT(2, queue.count);
+    TEST_ASSERT_EQUAL_UINT(3, queue.peak);
+}
+
+void test_watermarks_rejects_bad_marks(void) {
+    TEST_ASSERT_EQUAL_INT(-1, ipc_set_watermarks(&queue, 2, 2, record_watermark, NULL));
+    TEST_ASSERT_EQUAL_INT(-1, ipc_set_watermarks(&queue, 5, 1, record_watermark, NULL));
+    TEST_ASSERT_EQUAL_INT(0, ipc_set_watermarks(&queue, 4, 0, record_watermark, NULL));
+    /* Disabling needs no valid marks */
+    TEST_ASSERT_EQUAL_INT(0, ipc_set_watermarks(&queue, 0, 0, NULL, NULL));
+    TEST_ASSERT_NULL(queue.on_watermark);
+}
+
+static void disable_watermarks(void) {
+    ipc_set_watermarks(&queue, 0, 0, NULL, NULL);
+}
+
+void test_watermark_delivered_before_irqs_restored(void) {
+    int calls = 0, m;
+    event_count = 0;
+    ipc_set_watermarks(&queue, 2, 0, record_watermark, &calls);
+    ipc_send(&queue, &m);
+    /* Cleared as soon as IRQs are back: the crossing is already reported */
+    on_irq_restore = disable_watermarks;
+    ipc_send(&queue, &m);
+    TEST_ASSERT_EQUAL_INT(1, calls);
+    TEST_ASSERT_EQUAL(IPC_WATERMARK_HIGH, events[0]);
+    ipc_send(&queue, &m);
+    ipc_send(&queue, &m);
+    TEST_ASSERT_EQUAL_INT(1, calls);
+}
+
+/* A consumer preempting the sender the moment IRQs come back */
+static void drain_queue(void) {
+    void *r;
+    while (ipc_try_receive(&queue, &r) == 0)
+        ;
+}
+
+void test_watermark_events_keep_crossing_order(void) {
+    int calls = 0, m;
+    event_count = 0;
+    ipc_set_watermarks(&queue, 2, 0, record_watermark, &calls);
+    ipc_send(&queue, &m);
+    on_irq_restore = drain_queue;
+    ipc_send(&queue, &m);           /* 2: high, then drained to low */
+    TEST_ASSERT_EQUAL_INT(2, calls);
+    TEST_ASSERT_EQUAL(IPC_WATERMARK_HIGH, events[0]);
+    TEST_ASSERT_EQUAL(IPC_WATERMARK_LOW, events[1]);
+    TEST_ASSERT_FALSE(queue.above_high);
+}
+
+void test_watermarks_fire_once_with_hysteresis(void) {
+    int calls = 0, m;
+    void *out;
+    event_count = 0;
+    ipc_set_watermarks(&queue, 3, 1, record_watermark, &calls);
+
+    ipc_send(&queue, &m);
+    ipc_send(&queue, &m);
+    TEST_ASSERT_EQUAL_INT(0, calls);
+    ipc_send(&queue, &m);           /* 3: high */
+    ipc_send(&queue, &m);           /* 4: still high, no repeat */
+    ipc_receive(&queue, &out);      /* 3 */
+    ipc_receive(&queue, &out);      /* 2 */
+    ipc_send(&queue, &m);           /* 3 again, but not yet back at low */
+    TEST_ASSERT_EQUAL_INT(1, calls);
+    ipc_receive(&queue, &out);
+    ipc_receive(&queue, &out);      /* 1: low */
+    TEST_ASSERT_EQUAL_INT(2, calls);
+    TEST_ASSERT_EQUAL(IPC_WATERMARK_HIGH, events[0]);
+    TEST_ASSERT_EQUAL(IPC_WATERMARK_LOW, events[1]);
+}
+
+void test_watermarks_fire_from_batch_paths(void) {
+    int calls = 0;
+    int m[4];
+    void *msgs[4] = { &m[0], &m[1], &m[2], &m[3] };
+    void *out[4];
+    event_count = 0;
+    ipc_set_watermarks(&queue, 3, 0, record_watermark, &calls);
+    ipc_send_many(&queue, msgs, 4);
+    ipc_receive_many(&queue, out, 4);
+    TEST_ASSERT_EQUAL_INT(2, calls);
+    TEST_ASSERT_EQUAL(IPC_WATERMARK_HIGH, events[0]);
+    TEST_ASSERT_EQUAL(IPC_WATERMARK_LOW, events[1]);
+    TEST_ASSERT_EQUAL_UINT(4, queue.peak);
+}
+
+typedef struct {
+    uint32_t id;
+    uint16_t len;
+    uint8_t data[6];
+} Packet_t;
+
+void test_copy_init_rounds_stride_to_word(void) {
+    IPCCopy_t q;
+    TEST_ASSERT_EQUAL_INT(0, ipc_copy_init(&q, 4, 5));
+    TEST_ASSERT_EQUAL_UINT(5, q.item_size);
+    TEST_ASSERT_EQUAL_UINT(8, q.stride);
+    ipc_copy_destroy(&q);
+    TEST_ASSERT_EQUAL_INT(-1, ipc_copy_init(&q, 4, 0));
+}
+
+void test_copy_send_receive_by_value(void) {
+    IPCCopy_t q;
+    ipc_copy_init(&q, 4, sizeof(Packet_t));
+    Packet_t in = { 7, 3, { 1, 2, 3 } };
+    ipc_copy_send(&q, &in);
+    /* The queue holds its own copy; the sender's buffer can be reused */
+    in.id = 99;
+
+    Packet_t out;
+    TEST_ASSERT_EQUAL_INT(0, ipc_copy_receive(&q, &out));
+    TEST_ASSERT_EQUAL_UINT32(7, out.id);
+    TEST_ASSERT_EQUAL_UINT16(3, out.len);
+    TEST_ASSERT_EQUAL_UINT8(3, out.data[2]);
+    ipc_copy_destroy(&q);
+}
+
+void test_copy_unaligned_size_wraps_in_order(void) {
+    IPCCopy_t q;
+    ipc_copy_init(&q, 3, 3);
+    uint8_t out[3];
+    for (uint8_t i = 0; i < 10; i++) {
+        uint8_t in[3] = { i, (uint8_t)(i + 1), (uint8_t)(i + 2) };
+        ipc_copy_send(&q, in);
+        ipc_copy_receive(&q, out);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(in, out, 3);
+    }
+    ipc_copy_destroy(&q);
+}
+
+void test_copy_does_not_allocate_per_message(void) {
+    IPCCopy_t q;
+    ipc_copy_init(&q, 4, sizeof(Packet_t));
+    MemStats_t before, after;
+    mem_get_stats(&before);
+    Packet_t p = { 0 };
+    for (int i = 0; i < 16; i++) {
+        p.id = (uint32_t)i;
+        ipc_copy_send(&q, &p);
+        ipc_copy_receive(&q, &p);
+        TEST_ASSERT_EQUAL_UINT32(i, p.id);
+    }
+    mem_get_stats(&after);
+    TEST_ASSERT_EQUAL_UINT(before.alloc_count, after.alloc_count);
+    ipc_copy_destroy(&q);
+}
+
+void test_copy_receive_empty_blocks(void) {
+    IPCCopy_t q;
+    ipc_copy_init(&q, 2, sizeof(uint32_t));
+    TCB_t *task = setup_current_task(1);
+    uint32_t v;
+    TEST_ASSERT_EQUAL_INT(-1, ipc_copy_receive(&q, &v));
+    TEST_ASSERT_EQUAL_INT(1, yield_called);
+    TEST_ASSERT_EQUAL(TASK_STATE_BLOCKED, task->state);
+
+    setup_current_task(1);
+    v = 5;
+    ipc_copy_send(&q, &v);
+    TEST_ASSERT_EQUAL(TASK_STATE_READY, task->state);
+    ipc_copy_destroy(&q);
+}
+
+void test_copy_send_full_blocks(void) {
+    IPCCopy_t q;
+    ipc_copy_init(&q, 2, sizeof(uint32_t));
+    uint32_t v = 1;
+    ipc_copy_send(&q, &v);
+    ipc_copy_send(&q, &v);
+    TCB_t *task = setup_current_task(1);
+    TEST_ASSERT_EQUAL_INT(-1, ipc_copy_send(&q, &v));
+    TEST_ASSERT_EQUAL(TASK_STATE_BLOCKED, task->state);
+
+    setup_current_task(1);
+    ipc_copy_receive(&q, &v);
+    TEST_ASSERT_EQUAL(TASK_STATE_READY, task->state);
+    ipc_copy_destroy(&q);
+}
+
+/*
+ * A rival task runs while we sleep. On the first yield it hands us the
+ * wake-up and then takes what we were woken for. On the second it leaves
+ * the slot (or item) for us.
+ */
+static IPCCopy_t contended;
+static uint32_t rival_item;
+
+static void rival_consumer_steals_first(void) {
+    uint32_t v = 10 + (uint32_t)yield_called;
+    ipc_copy_send(&contended, &v);
+    if (yield_called == 1)
+        ipc_copy_receive(&contended, &rival_item);
+}
+
+void test_copy_receive_blocks_again_when_rival_takes_item(void) {
+    ipc_copy_init(&contended, 2, sizeof(uint32_t));
+    setup_current_task(1);
+    on_yield = rival_consumer_steals_first;
+    uint32_t v = 0;
+    TEST_ASSERT_EQUAL_INT(0, ipc_copy_receive(&contended, &v));
+    TEST_ASSERT_EQUAL_INT(2, yield_called);
+    TEST_ASSERT_EQUAL_UINT32(11, rival_item);
+    TEST_ASSERT_EQUAL_UINT32(12, v);
+    TEST_ASSERT_EQUAL_UINT(0, contended.count);
+    ipc_copy_destroy(&contended);
+}
+
+static void rival_producer_steals_first(void) {
+    ipc_copy_receive(&contended, &rival_item);
+    if (yield_called == 1) {
+        uint32_t v = 99;
+        ipc_copy_send(&contended, &v);
+    }
+}
+
+void test_copy_send_blocks_again_when_rival_takes_slot(void) {
+    ipc_copy_init(&contended, 1, sizeof(uint32_t));
+    uint32_t v = 1;
+    ipc_copy_send(&contended, &v);
+    setup_current_task(1);
+    on_yield = rival_producer_steals_first;
+    v = 2;
+    TEST_ASSERT_EQUAL_INT(0, ipc_copy_send(&contended, &v));
+    TEST_ASSERT_EQUAL_INT(2, yield_called);
+    /* The rival drained 1, then its own 99; our 2 is what remains */
+    TEST_ASSERT_EQUAL_UINT32(99, rival_item);
+    TEST_ASSERT_EQUAL_UINT(1, contended.count);
+    ipc_copy_receive(&contended, &v);
+    TEST_ASSERT_EQUAL_UINT32(2, v);
+    ipc_copy_destroy(&contended);
+}
+
+void test_prio_highest_first_fifo_within_level(void) {
+    IPCPrio_t q;
+    ipc_prio_init(&q, 8);
+    int bulk[3], ctl[2];
+    for (int i = 0; i < 3; i++)
+        ipc_prio_send(&q, &bulk[i], 7);
+    ipc_prio_send(&q, &ctl[0], 0);
+    ipc_prio_send(&q, &ctl[1], 0);
+
+    void *out;
+    ipc_prio_receive(&q, &out);
+    TEST_ASSERT_EQUAL_PTR(&ctl[0], out);
+    ipc_prio_receive(&q, &out);
+    TEST_ASSERT_EQUAL_PTR(&ctl[1], out);
+    for (int i = 0; i < 3; i++) {
+        ipc_prio_receive(&q, &out);
+        TEST_ASSERT_EQUAL_PTR(&bulk[i], out);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, q.ready);
+    ipc_prio_destroy(&q);
+}
+
+void test_prio_rejects_invalid_priority(void) {
+    IPCPrio_t q;
+    ipc_prio_init(&q, 2);
+    int m;
+    TEST_ASSERT_EQUAL_INT(-1, ipc_prio_send(&q, &m, IPC_PRIO_LEVELS));
+    TEST_ASSERT_EQUAL_UINT(0, q.count);
+    ipc_prio_destroy(&q);
+}
+
+void test_prio_nodes_recycled_without_allocation(void) {
+    IPCPrio_t q;
+    ipc_prio_init(&q, 2);
+    MemStats_t before, after;
+    mem_get_stats(&before);
+    void *out;
+    for (uintptr_t i = 0; i < 100; i++) {
+        TEST_ASSERT_EQUAL_INT(0, ipc_prio_send(&q, (void *)i, (uint8_t)(i % IPC_PRIO_LEVELS)));
+        ipc_prio_receive(&q, &out);
+        TEST_ASSERT_EQUAL_PTR((void *)i, out);
+    }
+    mem_get_stats(&after);
+    TEST_ASSERT_EQUAL_UINT(before.alloc_count, after.alloc_count);
+    ipc_prio_destroy(&q);
+}
+
+void test_prio_send_full_blocks(void) {
+    IPCPrio_t q;
+    ipc_prio_init(&q, 2);
+    int m;
+    ipc_prio_send(&q, &m, 3);
+    ipc_prio_send(&q, &m, 3);
+    TCB_t *task = setup_current_task(1);
+    TEST_ASSERT_EQUAL_INT(-1, ipc_prio_send(&q, &m, 0));
+    TEST_ASSERT_EQUAL(TASK_STATE_BLOCKED, task->state);
+
+    setup_current_task(1);
+    void *out;
+    ipc_prio_receive(&q, &out);
+    TEST_ASSERT_EQUAL(TASK_STATE_READY, task->state);
+    ipc_prio_destroy(&q);
+}
+
+void test_prio_receive_empty_blocks(void) {
+    IPCPrio_t q;
+    ipc_prio_init(&q, 2);
+    TCB_t *task = setup_current_task(1);
+    void *out;
+    TEST_ASSERT_EQUAL_INT(-1, ipc_prio_receive(&q, &out));
+    TEST_ASSERT_EQUAL(TASK_STATE_BLOCKED, task->state);
+    ipc_prio_destroy(&q);
+}
+
+static IPCPrio_t prio_contended;
+static void *prio_rival_got;
+static int prio_msgs[2];
+
+static void prio_rival_steals_first(void) {
+    ipc_prio_send(&prio_contended, &prio_msgs[yield_called - 1], 2);
+    if (yield_called == 1)
+        ipc_prio_receive(&prio_contended, &prio_rival_got);
+}
+
+void test_prio_receive_blocks_again_when_rival_takes_message(void) {
+    ipc_prio_init(&prio_contended, 2);
+    setup_current_task(1);
+    on_yield = prio_rival_steals_first;
+    void *out = NULL;
+    TEST_ASSERT_EQUAL_INT(0, ipc_prio_receive(&prio_contended, &out));
+    TEST_ASSERT_EQUAL_INT(2, yield_called);
+    TEST_ASSERT_EQUAL_PTR(&prio_msgs[0], prio_rival_got);
+    TEST_ASSERT_EQUAL_PTR(&prio_msgs[1], out);
+    TEST_ASSERT_EQUAL_UINT32(0, prio_contended.ready);
+    ipc_prio_destroy(&prio_contended);
+}
+
 int main(void) {
     UNITY_BEGIN();
     RUN_TEST(test_init_and_destroy);
@@ -137,5 +653,35 @@ int main(void) {
     RUN_TEST(test_receive_empty_blocks);
     RUN_TEST(test_send_full_blocks);
     RUN_TEST(test_send_unblocks_consumer);
+    RUN_TEST(test_try_send_full_fails_without_blocking);
+    RUN_TEST(test_try_receive_empty_fails_without_blocking);
+    RUN_TEST(test_send_overwrite_evicts_oldest);
+    RUN_TEST(test_send_many_receive_many_order);
+    RUN_TEST(test_batch_wraps_around);
+    RUN_TEST(test_receive_many_takes_what_is_available);
+    RUN_TEST(test_receive_many_blocks_when_empty);
+    RUN_TEST(test_receive_many_blocks_again_when_woken_empty);
+    RUN_TEST(test_send_many_wakes_one_consumer_per_message);
+    RUN_TEST(test_send_many_blocks_when_full);
+    RUN_TEST(test_peak_depth_tracked);
+    RUN_TEST(test_watermarks_rejects_bad_marks);
+    RUN_TEST(test_watermark_delivered_before_irqs_restored);
+    RUN_TEST(test_watermark_events_keep_crossing_order);
+    RUN_TEST(test_watermarks_fire_once_with_hysteresis);
+    RUN_TEST(test_watermarks_fire_from_batch_paths);
+    RUN_TEST(test_copy_init_rounds_stride_to_word);
+    RUN_TEST(test_copy_send_receive_by_value);
+    RUN_TEST(test_copy_unaligned_size_wraps_in_order);
+    RUN_TEST(test_copy_does_not_allocate_per_message);
+    RUN_TEST(test_copy_receive_empty_blocks);
+    RUN_TEST(test_copy_send_full_blocks);
+    RUN_TEST(test_copy_receive_blocks_again_when_rival_takes_item);
+    RUN_TEST(test_copy_send_blocks_again_when_rival_takes_slot);
+    RUN_TEST(test_prio_highest_first_fifo_within_level);
+    RUN_TEST(test_prio_rejects_invalid_priority);
+    RUN_TEST(test_prio_nodes_recycled_without_allocation);
+    RUN_TEST(test_prio_send_full_blocks);
+    RUN_TEST(test_prio_receive_empty_blocks);
+    RUN_TEST(test_prio_receive_blocks_again_when_rival_takes_message);
     return UNITY_END();
 }
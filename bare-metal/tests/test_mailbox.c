@@ -0,0 +1,219 @@
+#define _POSIX_C_SOURCE 200809L
+#include "unity.h"
+#include "mailbox.h"
+#include "mem.h"
+#include "scheduler.h"
+#include <pthread.h>
+
+static int yield_called;
+static void (*on_yield)(void);
+void task_yield(void) {
+    yield_called++;
+    if (on_yield)
+        on_yield();
+}
+
+extern TCB_t *scheduler_get_task_pool(void);
+
+typedef struct {
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+    uint32_t check;     /* a ^ b ^ c */
+} Sample_t;
+
+static Mailbox_t mb;
+
+static TCB_t *setup_current_task(uint8_t priority) {
+    TCB_t *pool = scheduler_get_task_pool();
+    for (int i = 0; i < MAX_TASKS; i++) {
+        if (pool[i].state == TASK_STATE_DEAD) {
+            pool[i].priority = priority;
+            pool[i].state = TASK_STATE_RUNNING;
+            pool[i].next = NULL;
+            current_tcb = &pool[i];
+            return &pool[i];
+        }
+    }
+    return NULL;
+}
+
+static Sample_t make_sample(uint32_t i) {
+    Sample_t s = { i, i * 3u, ~i, 0 };
+    s.check = s.a ^ s.b ^ s.c;
+    return s;
+}
+
+void setUp(void) {
+    init_allocator();
+    scheduler_init();
+    yield_called = 0;
+    on_yield = NULL;
+    mailbox_init(&mb, sizeof(Sample_t));
+    setup_current_task(1);
+}
+
+void tearDown(void) {
+    mailbox_destroy(&mb);
+}
+
+void test_peek_before_post_returns_zero(void) {
+    /* Recreate the mailbox on a block full of stale bytes */
+    mailbox_destroy(&mb);
+    void *stale = my_malloc(sizeof(Sample_t));
+    rt_memset(stale, 0xA5, sizeof(Sample_t));
+    my_free(stale);
+    mailbox_init(&mb, sizeof(Sample_t));
+
+    Sample_t out = make_sample(7);
+    TEST_ASSERT_EQUAL_UINT32(0, mailbox_peek(&mb, &out));
+    TEST_ASSERT_EQUAL_UINT32(0, out.a | out.b | out.c | out.check);
+}
+
+void test_post_overwrites_latest(void) {
+    Sample_t s1 = make_sample(1), s2 = make_sample(2), out;
+    mailbox_post(&mb, &s1);
+    mailbox_post(&mb, &s2);
+    uint32_t v = mailbox_peek(&mb, &out);
+    TEST_ASSERT_EQUAL_UINT32(4, v);
+    TEST_ASSERT_EQUAL_UINT32(2, out.a);
+    TEST_ASSERT_EQUAL_UINT32(out.check, out.a ^ out.b ^ out.c);
+    TEST_ASSERT_EQUAL_INT(0, yield_called);
+}
+
+void test_read_new_returns_unseen_value_without_blocking(void) {
+    Sample_t s = make_sample(7), out;
+    uint32_t version = 0;
+    mailbox_post(&mb, &s);
+    TEST_ASSERT_EQUAL_INT(0, mailbox_read_new(&mb, &out, &version));
+    TEST_ASSERT_EQUAL_UINT32(7, out.a);
+    TEST_ASSERT_EQUAL_UINT32(2, version);
+    TEST_ASSERT_EQUAL_INT(0, yield_called);
+}
+
+void test_read_new_blocks_until_post(void) {
+    Sample_t s = make_sample(1), out;
+    uint32_t version = 0;
+    mailbox_post(&mb, &s);
+    mailbox_read_new(&mb, &out, &version);
+
+    TCB_t *reader = setup_current_task(1);
+    /* The stub yield returns without a post: the reader gives up cleanly */
+    TEST_ASSERT_EQUAL_INT(-1, mailbox_read_new(&mb, &out, &version));
+    TEST_ASSERT_EQUAL_INT(1, yield_called);
+    TEST_ASSERT_EQUAL(TASK_STATE_RUNNING, reader->state);
+    TEST_ASSERT_NULL(mb.waiting);
+    TEST_ASSERT_NULL(reader->next);
+}
+
+/*
+ * While the first reader sleeps a second one blocks too, and while that
+ * one sleeps a writer posts.
+ */
+static TCB_t *readers[2];
+static uint32_t reader_version[2];
+static int reader_ret[2];
+
+static void second_reader_then_post(void) {
+    if (yield_called == 1) {
+        readers[1] = setup_current_task(2);
+        Sample_t out;
+        reader_ret[1] = mailbox_read_new(&mb, &out, &reader_version[1]);
+        current_tcb = readers[0];
+    } else {
+        setup_current_task(1);
+        Sample_t s = make_sample(3);
+        mailbox_post(&mb, &s);
+        current_tcb = readers[1];
+    }
+}
+
+void test_post_wakes_all_readers(void) {
+    Sample_t out;
+    readers[0] = setup_current_task(1);
+    reader_version[0] = reader_version[1] = 0;
+    on_yield = second_reader_then_post;
+    reader_ret[0] = mailbox_read_new(&mb, &out, &reader_version[0]);
+
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT_EQUAL_INT(0, reader_ret[i]);
+        TEST_ASSERT_EQUAL_UINT32(2, reader_version[i]);
+        TEST_ASSERT_EQUAL(TASK_STATE_READY, readers[i]->state);
+    }
+    TEST_ASSERT_EQUAL_UINT32(3, out.a);
+    TEST_ASSERT_NULL(mb.waiting);
+}
+
+/* Another core's reader blocks behind us while we sleep */
+static void second_reader_waits(void) {
+    readers[1] = setup_current_task(2);
+    readers[1]->state = TASK_STATE_BLOCKED;
+    readers[1]->next = mb.waiting;
+    mb.waiting = readers[1];
+    current_tcb = readers[0];
+}
+
+void test_read_new_without_post_unlinks_only_itself(void) {
+    Sample_t out;
+    uint32_t version = 0;
+    readers[0] = setup_current_task(1);
+    on_yield = second_reader_waits;
+    TEST_ASSERT_EQUAL_INT(-1, mailbox_read_new(&mb, &out, &version));
+    TEST_ASSERT_EQUAL(TASK_STATE_RUNNING, readers[0]->state);
+    TEST_ASSERT_NULL(readers[0]->next);
+    /* The other reader is still queued for the next post */
+    TEST_ASSERT_EQUAL_PTR(readers[1], mb.waiting);
+    TEST_ASSERT_NULL(readers[1]->next);
+
+    Sample_t s = make_sample(4);
+    mailbox_post(&mb, &s);
+    TEST_ASSERT_EQUAL(TASK_STATE_READY, readers[1]->state);
+}
+
+#define POSTS 200000
+
+static volatile int writer_done;
+
+static void *writer_thread(void *arg) {
+    (void)arg;
+    for (uint32_t i = 1; i <= POSTS; i++) {
+        Sample_t s = make_sample(i);
+        mailbox_post(&mb, &s);
+    }
+    atomic_set((volatile uint32_t *)&writer_done, 1);
+    return NULL;
+}
+
+void test_concurrent_reads_never_torn(void) {
+    writer_done = 0;
+    pthread_t t;
+    pthread_create(&t, NULL, writer_thread, NULL);
+    int torn = 0, reads = 0;
+    uint32_t last = 0;
+    Sample_t out;
+    while (!atomic_read((volatile uint32_t *)&writer_done)) {
+        uint32_t v = mailbox_peek(&mb, &out);
+        if (v == 0)
+            continue;
+        if (out.check != (out.a ^ out.b ^ out.c) || v < last)
+            torn++;
+        last = v;
+        reads++;
+    }
+    pthread_join(t, NULL);
+    TEST_ASSERT_EQUAL_INT(0, torn);
+    TEST_ASSERT_EQUAL_UINT32(2 * POSTS, mailbox_peek(&mb, &out));
+    TEST_ASSERT_EQUAL_UINT32(POSTS, out.a);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_peek_before_post_returns_zero);
+    RUN_TEST(test_post_overwrites_latest);
+    RUN_TEST(test_read_new_returns_unseen_value_without_blocking);
+    RUN_TEST(test_read_new_blocks_until_post);
+    RUN_TEST(test_post_wakes_all_readers);
+    RUN_TEST(test_read_new_without_post_unlinks_only_itself);
+    RUN_TEST(test_concurrent_reads_never_torn);
+    return UNITY_END();
+}
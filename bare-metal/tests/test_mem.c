@@ -104,6 +104,251 @@ void test_many_small_allocs(void) {
     TEST_ASSERT_NOT_NULL(ptr);
 }
 
+void test_stats_initial(void) {
+    MemStats_t st;
+    mem_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT(1024 * 1024, st.heap_size);
+    TEST_ASSERT_EQUAL_UINT(0, st.free_bytes);
+    TEST_ASSERT_EQUAL_UINT(0, st.free_blocks);
+    TEST_ASSERT_EQUAL_UINT(0, st.used_blocks);
+    TEST_ASSERT_EQUAL_UINT32(0, st.failed_allocs);
+}
+
+void test_stats_track_alloc_and_free(void) {
+    MemStats_t st;
+    void *a = my_malloc(100);
+    void *b = my_malloc(200);
+    mem_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(2, st.alloc_count);
+    TEST_ASSERT_EQUAL_UINT(2, st.used_blocks);
+    TEST_ASSERT_GREATER_OR_EQUAL(300, st.heap_used);
+    size_t high_water = st.heap_used;
+
+    my_free(a);
+    my_free(b);
+    mem_flush_cache();
+    mem_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(2, st.free_count);
+    TEST_ASSERT_EQUAL_UINT(0, st.used_blocks);
+    TEST_ASSERT_EQUAL_UINT(1, st.free_blocks);
+    TEST_ASSERT_EQUAL_UINT(st.free_bytes, st.largest_free);
+    /* High-water mark does not shrink after frees */
+    TEST_ASSERT_EQUAL_UINT(high_water, st.heap_used);
+}
+
+void test_stats_failed_alloc(void) {
+    MemStats_t st;
+    TEST_ASSERT_NULL(my_malloc(2 * 1024 * 1024));
+    mem_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT32(1, st.failed_allocs);
+    TEST_ASSERT_EQUAL_UINT32(0, st.alloc_count);
+}
+
+void test_stats_fragmentation(void) {
+    MemStats_t st;
+    void *ptrs[8];
+    /* Large enough to bypass the per-core magazines */
+    for (int i = 0; i < 8; i++)
+        ptrs[i] = my_malloc(512);
+    /* Free every other block: holes cannot coalesce */
+    for (int i = 0; i < 8; i += 2)
+        my_free(ptrs[i]);
+    mem_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT(4, st.free_blocks);
+    TEST_ASSERT_EQUAL_UINT(4, st.used_blocks);
+    TEST_ASSERT_LESS_THAN(st.free_bytes, st.largest_free);
+}
+
+void test_arena_alloc_aligned_and_distinct(void) {
+    Arena_t arena;
+    TEST_ASSERT_EQUAL_INT(0, arena_init(&arena, 1024));
+    uint8_t *a = (uint8_t *)arena_alloc(&arena, 3);
+    uint8_t *b = (uint8_t *)arena_alloc(&arena, 5);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NOT_NULL(b);
+    TEST_ASSERT_TRUE(b > a);
+    TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)b % sizeof(long));
+    arena_destroy(&arena);
+}
+
+void test_arena_exhaust(void) {
+    Arena_t arena;
+    arena_init(&arena, 256);
+    int count = 0;
+    while (arena_alloc(&arena, 32) != NULL)
+        count++;
+    TEST_ASSERT_EQUAL_INT(256 / 32, count);
+    arena_destroy(&arena);
+}
+
+void test_arena_rejects_huge_request(void) {
+    Arena_t arena;
+    arena_init(&arena, 256);
+    TEST_ASSERT_NULL(arena_alloc(&arena, SIZE_MAX));
+    TEST_ASSERT_NULL(arena_alloc(&arena, SIZE_MAX - 3));
+    TEST_ASSERT_EQUAL_UINT(0, arena_mark(&arena));
+    arena_destroy(&arena);
+}
+
+void test_arena_reset_reuses_memory(void) {
+    Arena_t arena;
+    arena_init(&arena, 256);
+    void *first = arena_alloc(&arena, 64);
+    arena_alloc(&arena, 64);
+    arena_reset(&arena);
+    TEST_ASSERT_EQUAL_UINT(0, arena_mark(&arena));
+    TEST_ASSERT_EQUAL_PTR(first, arena_alloc(&arena, 64));
+    arena_destroy(&arena);
+}
+
+void test_arena_mark_rewind_nested(void) {
+    Arena_t arena;
+    arena_init(&arena, 512);
+    arena_alloc(&arena, 32);
+    size_t outer = arena_mark(&arena);
+    void *o = arena_alloc(&arena, 32);
+    size_t inner = arena_mark(&arena);
+    arena_alloc(&arena, 64);
+    arena_rewind(&arena, inner);
+    TEST_ASSERT_EQUAL_UINT(inner, arena_mark(&arena));
+    arena_rewind(&arena, outer);
+    TEST_ASSERT_EQUAL_PTR(o, arena_alloc(&arena, 32));
+    arena_destroy(&arena);
+}
+
+void test_arena_destroy_returns_chunk(void) {
+    MemStats_t st;
+    Arena_t arena;
+    arena_init(&arena, 4096);
+    arena_alloc(&arena, 100);
+    arena_destroy(&arena);
+    mem_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT(0, st.used_blocks);
+}
+
+void test_memalign_alignments_up_to_16k(void) {
+    for (size_t align = 16; align <= 16384; align <<= 1) {
+        uint8_t *p = (uint8_t *)my_memalign(align, 100);
+        TEST_ASSERT_NOT_NULL(p);
+        TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)p % align);
+        rt_memset(p, 0xA5, 100);
+        my_free(p);
+    }
+    mem_flush_cache();
+    MemStats_t st;
+    mem_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT(0, st.used_blocks);
+    TEST_ASSERT_EQUAL_UINT(1, st.free_blocks);
+}
+
+void test_memalign_keeps_leading_gap_free(void) {
+    MemStats_t st;
+    void *small = my_malloc(24);
+    uint8_t *p = (uint8_t *)my_memalign(16384, 100);
+    TEST_ASSERT_NOT_NULL(p);
+    mem_get_stats(&st);
+    /* Everything carved but not handed out is still on the free list */
+    size_t held = st.heap_used - st.free_bytes - st.cached_bytes;
+    TEST_ASSERT_LESS_THAN(256, held);
+    /* Leading gap and trailing remainder are separate free blocks */
+    TEST_ASSERT_EQUAL_UINT(2, st.free_blocks);
+    my_free(p);
+    my_free(small);
+}
+
+void test_memalign_many_mixed(void) {
+    void *ptrs[24];
+    for (int i = 0; i < 24; i++) {
+        size_t align = (size_t)16 << (i % 9);
+        ptrs[i] = (i % 3 == 0) ? my_malloc(40) : my_memalign(align, 48 + i);
+        TEST_ASSERT_NOT_NULL(ptrs[i]);
+        if (i % 3 != 0)
+            TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)ptrs[i] % align);
+    }
+    for (int i = 0; i < 24; i += 2)
+        my_free(ptrs[i]);
+    for (int i = 1; i < 24; i += 2)
+        my_free(ptrs[i]);
+    mem_flush_cache();
+    MemStats_t st;
+    mem_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT(1, st.free_blocks);
+}
+
+void test_memalign_rejects_bad_alignment(void) {
+    TEST_ASSERT_NULL(my_memalign(48, 16));
+    TEST_ASSERT_NULL(my_memalign(0, 16));
+}
+
+void test_malloc_flags_cache_aligned(void) {
+    uint8_t *a = (uint8_t *)my_malloc_flags(10, MEM_CACHE_ALIGNED);
+    uint8_t *b = (uint8_t *)my_malloc_flags(10, MEM_CACHE_ALIGNED);
+    TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)a % CACHE_LINE_SIZE);
+    TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)b % CACHE_LINE_SIZE);
+    /* Never share a line with each other */
+    uintptr_t la = (uintptr_t)a / CACHE_LINE_SIZE;
+    uintptr_t lb = (uintptr_t)b / CACHE_LINE_SIZE;
+    TEST_ASSERT_NOT_EQUAL(la, lb);
+    my_free(a);
+    my_free(b);
+}
+
+void test_small_blocks_recycled_by_magazine(void) {
+    MemStats_t st;
+    void *a = my_malloc(16);
+    my_free(a);
+    mem_get_stats(&st);
+    TEST_ASSERT_GREATER_THAN(0, st.cached_blocks);
+    /* LIFO magazine hands the same block straight back */
+    TEST_ASSERT_EQUAL_PTR(a, my_malloc(16));
+}
+
+void test_flush_cache_returns_blocks(void) {
+    void *ptrs[32];
+    for (int i = 0; i < 32; i++)
+        ptrs[i] = my_malloc(8 + (size_t)i * 2);
+    for (int i = 0; i < 32; i++)
+        my_free(ptrs[i]);
+    mem_flush_cache();
+    MemStats_t st;
+    mem_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT(0, st.cached_blocks);
+    TEST_ASSERT_EQUAL_UINT(0, st.used_blocks);
+    TEST_ASSERT_EQUAL_UINT(1, st.free_blocks);
+    TEST_ASSERT_EQUAL_UINT32(32, st.alloc_count);
+    TEST_ASSERT_EQUAL_UINT32(32, st.free_count);
+}
+
+#ifdef MEM_CALLSITE_STATS
+static void *alloc_site_a(size_t n) { return my_malloc(n); }
+static void *alloc_site_b(size_t n) { return my_malloc(n); }
+
+void test_callsite_histogram(void) {
+    void *a1 = alloc_site_a(32);
+    void *a2 = alloc_site_a(32);
+    void *b1 = alloc_site_b(512);
+    my_free(a2);
+
+    MemCallsite_t sites[MEM_CALLSITE_SLOTS];
+    size_t n = mem_get_callsites(sites, MEM_CALLSITE_SLOTS);
+    TEST_ASSERT_EQUAL_UINT(2, n);
+
+    uint32_t allocs = 0, frees = 0;
+    for (size_t i = 0; i < n; i++) {
+        allocs += sites[i].allocs;
+        frees += sites[i].frees;
+    }
+    TEST_ASSERT_EQUAL_UINT32(3, allocs);
+    TEST_ASSERT_EQUAL_UINT32(1, frees);
+
+    my_free(a1);
+    my_free(b1);
+    n = mem_get_callsites(sites, MEM_CALLSITE_SLOTS);
+    for (size_t i = 0; i < n; i++)
+        TEST_ASSERT_EQUAL_UINT(0, sites[i].bytes);
+}
+#endif
+
 int main(void) {
     UNITY_BEGIN();
     RUN_TEST(test_malloc_returns_non_null);
@@ -117,5 +362,25 @@ int main(void) {
     RUN_TEST(test_free_null_is_safe);
     RUN_TEST(test_exhaust_heap);
     RUN_TEST(test_many_small_allocs);
+    RUN_TEST(test_stats_initial);
+    RUN_TEST(test_stats_track_alloc_and_free);
+    RUN_TEST(test_stats_failed_alloc);
+    RUN_TEST(test_stats_fragmentation);
+    RUN_TEST(test_arena_alloc_aligned_and_distinct);
+    RUN_TEST(test_arena_exhaust);
+    RUN_TEST(test_arena_rejects_huge_request);
+    RUN_TEST(test_arena_reset_reuses_memory);
+    RUN_TEST(test_arena_mark_rewind_nested);
+    RUN_TEST(test_arena_destroy_returns_chunk);
+    RUN_TEST(test_memalign_alignments_up_to_16k);
+    RUN_TEST(test_memalign_keeps_leading_gap_free);
+    RUN_TEST(test_memalign_many_mixed);
+    RUN_TEST(test_memalign_rejects_bad_alignment);
+    RUN_TEST(test_malloc_flags_cache_aligned);
+    RUN_TEST(test_small_blocks_recycled_by_magazine);
+    RUN_TEST(test_flush_cache_returns_blocks);
+#ifdef MEM_CALLSITE_STATS
+    RUN_TEST(test_callsite_histogram);
+#endif
     return UNITY_END();
 }
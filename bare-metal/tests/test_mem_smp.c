@@ -0,0 +1,113 @@
+/*
+ * Concurrency stress test for the allocator. Each pthread stands in for a
+ * core (cpu_id() is overridden per thread) and is preempted freely by the
+ * host scheduler, so the shared heap lock and the per-core magazines are
+ * exercised under real interleavings.
+ */
+
+#include "unity.h"
+#include "mem.h"
+#include "kernel.h"
+#include <pthread.h>
+
+#define THREADS   MAX_CPUS
+#define ITERS     50000
+#define LIVE      64
+
+static _Thread_local uint32_t this_cpu;
+
+uint32_t cpu_id(void) { return this_cpu; }
+
+typedef struct {
+    uint32_t cpu;
+    uint32_t errors;
+} Worker;
+
+static uint32_t next_rand(uint32_t *state) {
+    *state = *state * 1103515245u + 12345u;
+    return *state >> 8;
+}
+
+static void *worker(void *arg) {
+    Worker *w = (Worker *)arg;
+    uint8_t *live[LIVE] = {0};
+    size_t sizes[LIVE] = {0};
+    uint32_t rng = w->cpu * 7919u + 1;
+
+    this_cpu = w->cpu;
+    for (int i = 0; i < ITERS; i++) {
+        int slot = (int)(next_rand(&rng) % LIVE);
+        if (live[slot]) {
+            /* Verify the fill pattern survived other cores' traffic */
+            for (size_t j = 0; j < sizes[slot]; j++) {
+                if (live[slot][j] != (uint8_t)(w->cpu + slot))
+                    w->errors++;
+            }
+            my_free(live[slot]);
+            live[slot] = NULL;
+        } else {
+            /* Mostly magazine-sized requests, some large ones */
+            size_t n = (next_rand(&rng) % 8 == 0) ? 200 + next_rand(&rng) % 800
+                                                  : 1 + next_rand(&rng) % 120;
+            live[slot] = (uint8_t *)my_malloc(n);
+            if (!live[slot]) {
+                w->errors++;
+                continue;
+            }
+            sizes[slot] = n;
+            rt_memset(live[slot], (int)(w->cpu + slot), n);
+        }
+    }
+    for (int i = 0; i < LIVE; i++)
+        my_free(live[i]);
+    mem_flush_cache();
+    return NULL;
+}
+
+void setUp(void) {
+    init_allocator();
+}
+
+void tearDown(void) {
+}
+
+void test_concurrent_alloc_free(void) {
+    pthread_t threads[THREADS];
+    Worker workers[THREADS];
+
+    for (int i = 0; i < THREADS; i++) {
+        workers[i].cpu = (uint32_t)i;
+        workers[i].errors = 0;
+        pthread_create(&threads[i], NULL, worker, &workers[i]);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        TEST_ASSERT_EQUAL_UINT32(0, workers[i].errors);
+    }
+
+    /* Every block came back and the free list coalesced into one */
+    MemStats_t st;
+    mem_get_stats(&st);
+    TEST_ASSERT_EQUAL_UINT(0, st.used_blocks);
+    TEST_ASSERT_EQUAL_UINT(0, st.cached_blocks);
+    TEST_ASSERT_EQUAL_UINT(1, st.free_blocks);
+    TEST_ASSERT_EQUAL_UINT32(st.alloc_count, st.free_count);
+    TEST_ASSERT_EQUAL_UINT32(0, st.failed_allocs);
+}
+
+void test_magazines_absorb_small_traffic(void) {
+    Worker w = { .cpu = 0, .errors = 0 };
+    worker(&w);
+    MemStats_t st;
+    mem_get_stats(&st);
+    /* Most allocations never take the shared heap lock */
+    TEST_ASSERT_EQUAL_UINT32(0, w.errors);
+    TEST_ASSERT_GREATER_THAN(st.alloc_count / 2, st.cache_hits);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_concurrent_alloc_free);
+    RUN_TEST(test_magazines_absorb_small_traffic);
+    return UNITY_END();
+}
@@ -0,0 +1,222 @@
+#define _POSIX_C_SOURCE 200809L
+#include "unity.h"
+#include "mpmc.h"
+#include "mem.h"
+#include "scheduler.h"
+#include <pthread.h>
+#include <sched.h>
+
+static int yield_called;
+static void (*on_yield)(void);
+void task_yield(void) {
+    yield_called++;
+    if (on_yield)
+        on_yield();
+}
+
+extern TCB_t *scheduler_get_task_pool(void);
+
+static MPMC_t queue;
+
+static TCB_t *setup_current_task(uint8_t priority) {
+    TCB_t *pool = scheduler_get_task_pool();
+    for (int i = 0; i < MAX_TASKS; i++) {
+        if (pool[i].state == TASK_STATE_DEAD) {
+            pool[i].priority = priority;
+            pool[i].state = TASK_STATE_RUNNING;
+            pool[i].next = NULL;
+            current_tcb = &pool[i];
+            return &pool[i];
+        }
+    }
+    return NULL;
+}
+
+void setUp(void) {
+    init_allocator();
+    scheduler_init();
+    yield_called = 0;
+    on_yield = NULL;
+    mpmc_init(&queue, 4);
+    setup_current_task(1);
+}
+
+void tearDown(void) {
+    mpmc_destroy(&queue);
+}
+
+void test_init_requires_power_of_two(void) {
+    MPMC_t q;
+    TEST_ASSERT_EQUAL_INT(-1, mpmc_init(&q, 3));
+    TEST_ASSERT_EQUAL_INT(-1, mpmc_init(&q, 1));
+    TEST_ASSERT_EQUAL_INT(0, mpmc_init(&q, 16));
+    TEST_ASSERT_EQUAL_UINT32(15, q.mask);
+    mpmc_destroy(&q);
+}
+
+void test_positions_on_separate_cache_lines(void) {
+    uintptr_t e = (uintptr_t)&queue.enqueue_pos / CACHE_LINE_SIZE;
+    uintptr_t d = (uintptr_t)&queue.dequeue_pos / CACHE_LINE_SIZE;
+    TEST_ASSERT_NOT_EQUAL(e, d);
+}
+
+void test_push_pop_fifo_and_bounds(void) {
+    for (uintptr_t i = 1; i <= 4; i++)
+        TEST_ASSERT_EQUAL_INT(0, mpmc_try_push(&queue, i));
+    TEST_ASSERT_EQUAL_INT(-1, mpmc_try_push(&queue, 5));
+    TEST_ASSERT_EQUAL_UINT(4, mpmc_count(&queue));
+    uintptr_t v;
+    for (uintptr_t i = 1; i <= 4; i++) {
+        TEST_ASSERT_EQUAL_INT(0, mpmc_try_pop(&queue, &v));
+        TEST_ASSERT_EQUAL_UINT(i, v);
+    }
+    TEST_ASSERT_EQUAL_INT(-1, mpmc_try_pop(&queue, &v));
+}
+
+void test_wraparound(void) {
+    uintptr_t v;
+    for (uintptr_t i = 0; i < 1000; i++) {
+        TEST_ASSERT_EQUAL_INT(0, mpmc_try_push(&queue, i));
+        TEST_ASSERT_EQUAL_INT(0, mpmc_try_pop(&queue, &v));
+        TEST_ASSERT_EQUAL_UINT(i, v);
+    }
+}
+
+void test_fast_path_never_yields(void) {
+    uintptr_t v;
+    mpmc_push(&queue, 1);
+    mpmc_pop(&queue, &v);
+    TEST_ASSERT_EQUAL_INT(0, yield_called);
+    TEST_ASSERT_EQUAL_UINT32(0, queue.consumers_waiting);
+    TEST_ASSERT_EQUAL_UINT32(0, queue.producers_waiting);
+}
+
+void test_pop_blocks_and_push_wakes(void) {
+    TCB_t *consumer = setup_current_task(1);
+    uintptr_t v;
+    TEST_ASSERT_EQUAL_INT(-1, mpmc_pop(&queue, &v));
+    TEST_ASSERT_EQUAL_INT(1, yield_called);
+    TEST_ASSERT_EQUAL(TASK_STATE_BLOCKED, consumer->state);
+    TEST_ASSERT_EQUAL_UINT32(1, queue.consumers_waiting);
+
+    setup_current_task(1);
+    mpmc_push(&queue, 9);
+    TEST_ASSERT_EQUAL(TASK_STATE_READY, consumer->state);
+    TEST_ASSERT_EQUAL_UINT32(0, queue.consumers_waiting);
+    TEST_ASSERT_NULL(queue.waitingConsumers);
+}
+
+void test_push_blocks_and_pop_wakes(void) {
+    for (uintptr_t i = 0; i < 4; i++)
+        mpmc_push(&queue, i);
+    TCB_t *producer = setup_current_task(1);
+    TEST_ASSERT_EQUAL_INT(-1, mpmc_push(&queue, 4));
+    TEST_ASSERT_EQUAL(TASK_STATE_BLOCKED, producer->state);
+    TEST_ASSERT_EQUAL_UINT32(1, queue.producers_waiting);
+
+    setup_current_task(1);
+    uintptr_t v;
+    mpmc_pop(&queue, &v);
+    TEST_ASSERT_EQUAL(TASK_STATE_READY, producer->state);
+    TEST_ASSERT_EQUAL_UINT32(0, queue.producers_waiting);
+}
+
+/* Wake the consumer, but let another consumer take the first item */
+static void push_first_stolen(void) {
+    uintptr_t v;
+    mpmc_try_push(&queue, (uintptr_t)yield_called);
+    if (yield_called == 1)
+        mpmc_try_pop(&queue, &v);
+}
+
+void test_pop_blocks_again_if_item_taken(void) {
+    TCB_t *consumer = setup_current_task(1);
+    on_yield = push_first_stolen;
+    uintptr_t v = 0;
+    TEST_ASSERT_EQUAL_INT(0, mpmc_pop(&queue, &v));
+    TEST_ASSERT_EQUAL_INT(2, yield_called);
+    TEST_ASSERT_EQUAL_UINT(2, v);
+    TEST_ASSERT_EQUAL(TASK_STATE_READY, consumer->state);
+    TEST_ASSERT_EQUAL_UINT32(0, queue.consumers_waiting);
+}
+
+/* --- stress: pthreads stand in for cores --- */
+
+#define STRESS_THREADS 4
+#define STRESS_ITEMS   50000
+
+static MPMC_t stress_q;
+static uint32_t consumed[STRESS_THREADS];
+static volatile uint32_t total_consumed;
+static int order_errors[STRESS_THREADS];
+
+static void *stress_producer(void *arg) {
+    uintptr_t id = (uintptr_t)arg;
+    for (uintptr_t i = 0; i < STRESS_ITEMS; i++) {
+        while (mpmc_try_push(&stress_q, (id << 24) | i) != 0)
+            sched_yield();
+    }
+    return NULL;
+}
+
+static void *stress_consumer(void *arg) {
+    int me = (int)(uintptr_t)arg;
+    /* Each producer's items must come out in the order it pushed them */
+    uintptr_t last[STRESS_THREADS];
+    for (int i = 0; i < STRESS_THREADS; i++)
+        last[i] = (uintptr_t)-1;
+    uintptr_t v;
+    while (atomic_read(&total_consumed) < STRESS_THREADS * STRESS_ITEMS) {
+        if (mpmc_try_pop(&stress_q, &v) != 0) {
+            sched_yield();
+            continue;
+        }
+        uintptr_t p = v >> 24, seq = v & 0xFFFFFF;
+        if (last[p] != (uintptr_t)-1 && seq <= last[p])
+            order_errors[me]++;
+        last[p] = seq;
+        consumed[me]++;
+        atomic_add_return(&total_consumed, 1);
+    }
+    return NULL;
+}
+
+void test_concurrent_producers_and_consumers(void) {
+    mpmc_init(&stress_q, 64);
+    total_consumed = 0;
+    pthread_t prod[STRESS_THREADS], cons[STRESS_THREADS];
+    for (uintptr_t i = 0; i < STRESS_THREADS; i++) {
+        consumed[i] = 0;
+        order_errors[i] = 0;
+        pthread_create(&cons[i], NULL, stress_consumer, (void *)i);
+    }
+    for (uintptr_t i = 0; i < STRESS_THREADS; i++)
+        pthread_create(&prod[i], NULL, stress_producer, (void *)i);
+    for (int i = 0; i < STRESS_THREADS; i++)
+        pthread_join(prod[i], NULL);
+    for (int i = 0; i < STRESS_THREADS; i++)
+        pthread_join(cons[i], NULL);
+
+    uint32_t sum = 0;
+    for (int i = 0; i < STRESS_THREADS; i++) {
+        sum += consumed[i];
+        TEST_ASSERT_EQUAL_INT(0, order_errors[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(STRESS_THREADS * STRESS_ITEMS, sum);
+    TEST_ASSERT_EQUAL_UINT(0, mpmc_count(&stress_q));
+    mpmc_destroy(&stress_q);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_init_requires_power_of_two);
+    RUN_TEST(test_positions_on_separate_cache_lines);
+    RUN_TEST(test_push_pop_fifo_and_bounds);
+    RUN_TEST(test_wraparound);
+    RUN_TEST(test_fast_path_never_yields);
+    RUN_TEST(test_pop_blocks_and_push_wakes);
+    RUN_TEST(test_push_blocks_and_pop_wakes);
+    RUN_TEST(test_pop_blocks_again_if_item_taken);
+    RUN_TEST(test_concurrent_producers_and_consumers);
+    return UNITY_END();
+}
@@ -1,6 +1,9 @@
 #include "unity.h"
 #include "mq.h"
 #include "mem.h"
+#include "scheduler.h"
+#include "semaphore.h"
+#include "host_tasks.h"
 
 static MQ_t queue;
 static int callback_count;
@@ -23,6 +26,7 @@ static void second_callback(void *message, void *context) {
 
 void setUp(void) {
     init_allocator();
+    mq_dispatcher_init(4);
     mq_init(&queue);
     callback_count = 0;
     second_callback_count = 0;
@@ -104,6 +108,604 @@ void test_publish_multiple_times(void) {
     TEST_ASSERT_EQUAL_PTR(&msg3, last_message);
 }
 
+void test_subscribers_stored_contiguously(void) {
+    int ctx = 0;
+    mq_subscribe(&queue, test_callback, NULL);
+    mq_subscribe(&queue, second_callback, &ctx);
+    TEST_ASSERT_EQUAL_UINT(2, queue.subscribers->count);
+    TEST_ASSERT_EQUAL_PTR(test_callback, queue.subscribers->entries[0].callback);
+    TEST_ASSERT_EQUAL_PTR(second_callback, queue.subscribers->entries[1].callback);
+    TEST_ASSERT_EQUAL_PTR(&ctx, queue.subscribers->entries[1].context);
+}
+
+void test_unsubscribe_last_leaves_null(void) {
+    mq_subscribe(&queue, test_callback, NULL);
+    mq_unsubscribe(&queue, test_callback, NULL);
+    TEST_ASSERT_NULL(queue.subscribers);
+    TEST_ASSERT_NULL(queue.retired);
+}
+
+static void unsubscribe_self(void *message, void *context) {
+    (void)message;
+    (void)context;
+    callback_count++;
+    mq_unsubscribe(&queue, unsubscribe_self, NULL);
+}
+
+void test_unsubscribe_during_publish(void) {
+    mq_subscribe(&queue, unsubscribe_self, NULL);
+    mq_subscribe(&queue, second_callback, NULL);
+    int msg = 1;
+    /* The running publish keeps its snapshot, so both are called once */
+    mq_publish(&queue, &msg);
+    TEST_ASSERT_EQUAL_INT(1, callback_count);
+    TEST_ASSERT_EQUAL_INT(1, second_callback_count);
+
+    mq_publish(&queue, &msg);
+    TEST_ASSERT_EQUAL_INT(1, callback_count);
+    TEST_ASSERT_EQUAL_INT(2, second_callback_count);
+}
+
+static bool retired_while_in_flight;
+
+static void subscribe_other(void *message, void *context) {
+    (void)message;
+    (void)context;
+    mq_subscribe(&queue, second_callback, NULL);
+    retired_while_in_flight = queue.retired != NULL;
+}
+
+void test_old_snapshot_reclaimed_after_publish(void) {
+    mq_subscribe(&queue, subscribe_other, NULL);
+    MemStats_t before, after;
+    mem_get_stats(&before);
+
+    int msg = 1;
+    retired_while_in_flight = false;
+    mq_publish(&queue, &msg);
+    TEST_ASSERT_TRUE(retired_while_in_flight);
+    TEST_ASSERT_EQUAL_UINT32(0, queue.pinning);
+
+    mq_reclaim(&queue);
+    TEST_ASSERT_NULL(queue.retired);
+    mem_get_stats(&after);
+    /* One snapshot replaced by another: no net blocks */
+    TEST_ASSERT_EQUAL_UINT(before.alloc_count + 1, after.alloc_count);
+    TEST_ASSERT_EQUAL_UINT(before.free_count + 1, after.free_count);
+}
+
+typedef struct {
+    uint8_t type;
+    uint8_t flags;
+    uint16_t device;
+    uint32_t value;
+} DeviceMsg_t;
+
+static void count_in_context(void *message, void *context) {
+    (void)message;
+    (*(int *)context)++;
+}
+
+void test_filtered_subscriber_skips_non_matching(void) {
+    MQFilter_t by_device = { offsetof(DeviceMsg_t, device), 2, 0xFFFF, 7 };
+    int hits = 0;
+    TEST_ASSERT_EQUAL_INT(0, mq_subscribe_filtered(&queue, count_in_context,
+                                                   &hits, &by_device));
+    DeviceMsg_t other = { 1, 0, 3, 0 };
+    DeviceMsg_t mine = { 1, 0, 7, 0 };
+    mq_publish(&queue, &other);
+    mq_publish(&queue, &mine);
+    mq_publish(&queue, &other);
+    TEST_ASSERT_EQUAL_INT(1, hits);
+}
+
+void test_filter_mask_selects_bits(void) {
+    /* Any message with flag bit 2 set, whatever the other bits */
+    MQFilter_t urgent = { offsetof(DeviceMsg_t, flags), 1, 0x04, 0x04 };
+    int hits = 0;
+    mq_subscribe_filtered(&queue, count_in_context, &hits, &urgent);
+    DeviceMsg_t a = { 0, 0x05, 0, 0 };
+    DeviceMsg_t b = { 0, 0x03, 0, 0 };
+    DeviceMsg_t c = { 0, 0xFC, 0, 0 };
+    mq_publish(&queue, &a);
+    mq_publish(&queue, &b);
+    mq_publish(&queue, &c);
+    TEST_ASSERT_EQUAL_INT(2, hits);
+}
+
+void test_filtered_and_unfiltered_mixed(void) {
+    MQFilter_t by_value = { offsetof(DeviceMsg_t, value), 4, 0xFFFFFFFF, 100 };
+    int filtered_hits = 0;
+    mq_subscribe(&queue, test_callback, NULL);
+    mq_subscribe_filtered(&queue, count_in_context, &filtered_hits, &by_value);
+    mq_subscribe(&queue, second_callback, NULL);
+    TEST_ASSERT_EQUAL_UINT(1, queue.subscribers->filtered);
+
+    DeviceMsg_t m = { 0, 0, 0, 100 };
+    DeviceMsg_t n = { 0, 0, 0, 101 };
+    mq_publish(&queue, &m);
+    mq_publish(&queue, &n);
+    TEST_ASSERT_EQUAL_INT(2, callback_count);
+    TEST_ASSERT_EQUAL_INT(2, second_callback_count);
+    TEST_ASSERT_EQUAL_INT(1, filtered_hits);
+
+    /* Filters move with their entries when the set is rebuilt */
+    mq_unsubscribe(&queue, test_callback, NULL);
+    mq_publish(&queue, &n);
+    TEST_ASSERT_EQUAL_INT(1, filtered_hits);
+    TEST_ASSERT_EQUAL_INT(3, second_callback_count);
+    mq_unsubscribe(&queue, count_in_context, &filtered_hits);
+    TEST_ASSERT_EQUAL_UINT(0, queue.subscribers->filtered);
+}
+
+void test_filters_across_batches(void) {
+    /* More subscribers than one 32-bit match mask */
+    static int hits[40];
+    static MQFilter_t filters[40];
+    for (int i = 0; i < 40; i++) {
+        hits[i] = 0;
+        filters[i] = (MQFilter_t){ offsetof(DeviceMsg_t, device), 2, 0xFFFF,
+                                   (uint32_t)i };
+        TEST_ASSERT_EQUAL_INT(0, mq_subscribe_filtered(&queue, count_in_context,
+                                                       &hits[i], &filters[i]));
+    }
+    DeviceMsg_t m = { 0, 0, 35, 0 };
+    mq_publish(&queue, &m);
+    m.device = 3;
+    mq_publish(&queue, &m);
+    for (int i = 0; i < 40; i++)
+        TEST_ASSERT_EQUAL_INT(i == 35 || i == 3 ? 1 : 0, hits[i]);
+}
+
+void test_invalid_filter_rejected(void) {
+    MQFilter_t bad_size = { 0, 3, 0xFF, 0 };
+    MQFilter_t wide_mask = { 0, 1, 0x1FF, 0 };
+    MQFilter_t unmatchable = { 0, 4, 0x0F, 0x10 };
+    TEST_ASSERT_EQUAL_INT(-1, mq_subscribe_filtered(&queue, test_callback,
+                                                    NULL, &bad_size));
+    TEST_ASSERT_EQUAL_INT(-1, mq_subscribe_filtered(&queue, test_callback,
+                                                    NULL, &wide_mask));
+    TEST_ASSERT_EQUAL_INT(-1, mq_subscribe_filtered(&queue, test_callback,
+                                                    NULL, &unmatchable));
+    TEST_ASSERT_NULL(queue.subscribers);
+}
+
+static MsgBuf_t *make_state(MsgPool_t *pool, uint32_t value) {
+    MsgBuf_t *mb = msgbuf_alloc(pool);
+    rt_memcpy(msgbuf_put(mb, sizeof(value)), &value, sizeof(value));
+    return mb;
+}
+
+void test_late_subscriber_gets_retained(void) {
+    MsgPool_t pool;
+    msgpool_init(&pool, 4, 16, 0);
+    mq_set_msgbuf(&queue, true);
+    mq_subscribe(&queue, second_callback, NULL);
+
+    MsgBuf_t *mb = make_state(&pool, 5);
+    mq_publish_retained(&queue, mb);
+    msgbuf_release(mb);
+    TEST_ASSERT_EQUAL_INT(1, second_callback_count);
+
+    int ctx;
+    mq_subscribe(&queue, test_callback, &ctx);
+    /* Only the new subscriber sees the retained value */
+    TEST_ASSERT_EQUAL_INT(1, callback_count);
+    TEST_ASSERT_EQUAL_PTR(mb, last_message);
+    TEST_ASSERT_EQUAL_PTR(&ctx, last_context);
+    TEST_ASSERT_EQUAL_INT(1, second_callback_count);
+
+    mq_destroy(&queue);
+    TEST_ASSERT_EQUAL_UINT(4, pool.available);
+    msgpool_destroy(&pool);
+}
+
+void test_retained_replaced_releases_old(void) {
+    MsgPool_t pool;
+    msgpool_init(&pool, 4, 16, 0);
+    mq_set_msgbuf(&queue, true);
+    MsgBuf_t *first = make_state(&pool, 1);
+    mq_publish_retained(&queue, first);
+    msgbuf_release(first);
+    TEST_ASSERT_EQUAL_UINT(3, pool.available);
+
+    MsgBuf_t *second = make_state(&pool, 2);
+    mq_publish_retained(&queue, second);
+    msgbuf_release(second);
+    TEST_ASSERT_EQUAL_UINT(3, pool.available);
+    TEST_ASSERT_EQUAL_PTR(second, queue.retained);
+
+    mq_subscribe(&queue, test_callback, NULL);
+    TEST_ASSERT_EQUAL_PTR(second, last_message);
+    /* The reference taken for delivery is dropped again */
+    TEST_ASSERT_EQUAL_UINT32(1, second->refs);
+
+    mq_destroy(&queue);
+    msgpool_destroy(&pool);
+}
+
+void test_clear_retained(void) {
+    MsgPool_t pool;
+    msgpool_init(&pool, 2, 16, 0);
+    mq_set_msgbuf(&queue, true);
+    MsgBuf_t *mb = make_state(&pool, 9);
+    mq_publish_retained(&queue, mb);
+    msgbuf_release(mb);
+    mq_clear_retained(&queue);
+    TEST_ASSERT_EQUAL_UINT(2, pool.available);
+
+    mq_subscribe(&queue, test_callback, NULL);
+    TEST_ASSERT_EQUAL_INT(0, callback_count);
+    mq_destroy(&queue);
+    msgpool_destroy(&pool);
+}
+
+void test_retained_respects_filter(void) {
+    MsgPool_t pool;
+    msgpool_init(&pool, 2, 16, 0);
+    mq_set_msgbuf(&queue, true);
+    MsgBuf_t *mb = make_state(&pool, 9);
+    mq_publish_retained(&queue, mb);
+    msgbuf_release(mb);
+
+    /* Filters read the payload, not the MsgBuf_t header */
+    MQFilter_t eight = { 0, 4, 0xFFFFFFFF, 8 };
+    MQFilter_t nine = { 0, 4, 0xFFFFFFFF, 9 };
+    int eights = 0, nines = 0;
+    mq_subscribe_filtered(&queue, count_in_context, &eights, &eight);
+    mq_subscribe_filtered(&queue, count_in_context, &nines, &nine);
+    TEST_ASSERT_EQUAL_INT(0, eights);
+    TEST_ASSERT_EQUAL_INT(1, nines);
+
+    /* The same rule for an ordinary publish on the topic */
+    mb = make_state(&pool, 8);
+    mq_publish(&queue, mb);
+    msgbuf_release(mb);
+    TEST_ASSERT_EQUAL_INT(1, eights);
+    TEST_ASSERT_EQUAL_INT(1, nines);
+    mq_destroy(&queue);
+    msgpool_destroy(&pool);
+}
+
+void test_retained_needs_msgbuf_topic(void) {
+    MsgPool_t pool;
+    msgpool_init(&pool, 1, 16, 0);
+    MsgBuf_t *mb = make_state(&pool, 1);
+    TEST_ASSERT_EQUAL_INT(-1, mq_publish_retained(&queue, mb));
+    TEST_ASSERT_NULL(queue.retained);
+    TEST_ASSERT_EQUAL_UINT32(1, mb->refs);
+    msgbuf_release(mb);
+    msgpool_destroy(&pool);
+}
+
+void test_async_retained_held_until_dispatched(void) {
+    MsgPool_t pool;
+    msgpool_init(&pool, 2, 16, 0);
+    mq_set_msgbuf(&queue, true);
+    mq_set_mode(&queue, MQ_ASYNC);
+    mq_subscribe(&queue, test_callback, NULL);
+
+    MsgBuf_t *mb = make_state(&pool, 4);
+    mq_publish_retained(&queue, mb);
+    msgbuf_release(mb);
+    /* Replaced before the dispatcher ran: the queued entry still holds it */
+    mq_clear_retained(&queue);
+    TEST_ASSERT_EQUAL_UINT(1, pool.available);
+    TEST_ASSERT_EQUAL_UINT32(1, mb->refs);
+
+    TEST_ASSERT_EQUAL_UINT(1, mq_dispatch_pending());
+    TEST_ASSERT_EQUAL_PTR(mb, last_message);
+    TEST_ASSERT_EQUAL_UINT(2, pool.available);
+    mq_destroy(&queue);
+    msgpool_destroy(&pool);
+}
+
+void test_queue_subscriber_defers_delivery(void) {
+    MQSubQueue_t sq;
+    TEST_ASSERT_EQUAL_INT(0, mq_subscribe_queue(&queue, &sq, 4, MQ_DROP_NEWEST, NULL));
+    int a = 1, b = 2;
+    mq_publish(&queue, &a);
+    mq_publish(&queue, &b);
+
+    void *out;
+    TEST_ASSERT_EQUAL_INT(0, mq_queue_try_receive(&sq, &out));
+    TEST_ASSERT_EQUAL_PTR(&a, out);
+    TEST_ASSERT_EQUAL_INT(0, mq_queue_receive(&sq, &out));
+    TEST_ASSERT_EQUAL_PTR(&b, out);
+    TEST_ASSERT_EQUAL_INT(-1, mq_queue_try_receive(&sq, &out));
+    TEST_ASSERT_EQUAL_INT(0, mq_unsubscribe_queue(&queue, &sq));
+    TEST_ASSERT_NULL(queue.subscribers);
+}
+
+void test_queue_drop_newest_counts_drops(void) {
+    MQSubQueue_t sq;
+    mq_subscribe_queue(&queue, &sq, 2, MQ_DROP_NEWEST, NULL);
+    mq_subscribe(&queue, test_callback, NULL);
+    int m[5];
+    for (int i = 0; i < 5; i++)
+        mq_publish(&queue, &m[i]);
+    /* Inline subscribers are unaffected by the full queue */
+    TEST_ASSERT_EQUAL_INT(5, callback_count);
+    TEST_ASSERT_EQUAL_UINT32(3, sq.dropped);
+
+    void *out;
+    mq_queue_try_receive(&sq, &out);
+    TEST_ASSERT_EQUAL_PTR(&m[0], out);
+    mq_queue_try_receive(&sq, &out);
+    TEST_ASSERT_EQUAL_PTR(&m[1], out);
+    mq_unsubscribe_queue(&queue, &sq);
+}
+
+void test_queue_drop_oldest_keeps_latest(void) {
+    MQSubQueue_t sq;
+    mq_subscribe_queue(&queue, &sq, 2, MQ_DROP_OLDEST, NULL);
+    int m[5];
+    for (int i = 0; i < 5; i++)
+        mq_publish(&queue, &m[i]);
+    TEST_ASSERT_EQUAL_UINT32(3, sq.dropped);
+
+    void *out;
+    mq_queue_try_receive(&sq, &out);
+    TEST_ASSERT_EQUAL_PTR(&m[3], out);
+    mq_queue_try_receive(&sq, &out);
+    TEST_ASSERT_EQUAL_PTR(&m[4], out);
+    mq_unsubscribe_queue(&queue, &sq);
+}
+
+void test_queue_holds_msgbuf_references(void) {
+    MsgPool_t pool;
+    msgpool_init(&pool, 4, 16, 0);
+    mq_set_msgbuf(&queue, true);
+    MQSubQueue_t sq;
+    mq_subscribe_queue(&queue, &sq, 2, MQ_DROP_OLDEST, NULL);
+    for (uint32_t i = 0; i < 4; i++) {
+        MsgBuf_t *mb = make_state(&pool, i);
+        mq_publish(&queue, mb);
+        msgbuf_release(mb);
+    }
+    /* The two evicted buffers went back; the queue holds the other two */
+    TEST_ASSERT_EQUAL_UINT32(2, sq.dropped);
+    TEST_ASSERT_EQUAL_UINT(2, pool.available);
+
+    void *out;
+    mq_queue_try_receive(&sq, &out);
+    TEST_ASSERT_EQUAL_UINT8(2, ((MsgBuf_t *)out)->data[0]);
+    msgbuf_release((MsgBuf_t *)out);
+    TEST_ASSERT_EQUAL_UINT(3, pool.available);
+    /* Unsubscribing releases what is still queued */
+    mq_unsubscribe_queue(&queue, &sq);
+    TEST_ASSERT_EQUAL_UINT(4, pool.available);
+    msgpool_destroy(&pool);
+}
+
+static MQSubQueue_t blocking_sq;
+static char order[8];
+static int logged;
+
+static void log_event(char c) {
+    order[logged++] = c;
+    order[logged] = '\0';
+}
+
+static void blocked_publisher(void) {
+    int m[2];
+    mq_publish(&queue, &m[0]);
+    /* The queue is full: blocks inside delivery */
+    mq_publish(&queue, &m[1]);
+    log_event('p');
+}
+
+static void unsubscribing_owner(void) {
+    TEST_ASSERT_EQUAL_INT(0, mq_unsubscribe_queue(&queue, &blocking_sq));
+    log_event('u');
+}
+
+void test_unsubscribe_queue_with_blocked_publisher(void) {
+    host_tasks_init();
+    logged = 0;
+    mq_subscribe_queue(&queue, &blocking_sq, 1, MQ_BLOCK, NULL);
+    host_task_create(blocked_publisher, 1);
+    host_task_create(unsubscribing_owner, 2);
+    host_tasks_run();
+    /* The owner's drain let the publisher finish, then the queue went */
+    TEST_ASSERT_EQUAL_STRING("pu", order);
+    TEST_ASSERT_NULL(queue.subscribers);
+    TEST_ASSERT_EQUAL_UINT32(0, queue.pinning);
+    TEST_ASSERT_NULL(queue.retired);
+}
+
+static void steady_publisher(void) {
+    int m;
+    for (int i = 0; i < 50; i++) {
+        mq_publish(&queue, &m);
+        task_yield();
+    }
+    log_event('p');
+}
+
+static void unsubscribe_while_publishing(void) {
+    task_yield();
+    TEST_ASSERT_EQUAL_INT(0, mq_unsubscribe_queue(&queue, &blocking_sq));
+    log_event('u');
+}
+
+static void yielding_callback(void *message, void *context) {
+    (void)message;
+    (void)context;
+    task_yield();
+}
+
+void test_unsubscribe_queue_under_steady_publishing(void) {
+    host_tasks_init();
+    logged = 0;
+    mq_subscribe(&queue, yielding_callback, NULL);
+    mq_subscribe_queue(&queue, &blocking_sq, 4, MQ_DROP_NEWEST, NULL);
+    /* Two publishers keep a publish in flight on the topic at all times */
+    host_task_create(steady_publisher, 2);
+    host_task_create(steady_publisher, 2);
+    host_task_create(unsubscribe_while_publishing, 2);
+    host_tasks_run();
+    /* Done long before the publishers, though the topic never went idle */
+    TEST_ASSERT_EQUAL_STRING("upp", order);
+    TEST_ASSERT_EQUAL_UINT(1, queue.subscribers->count);
+}
+
+static size_t retired_count(void) {
+    size_t n = 0;
+    for (SubscriberSet_t *set = queue.retired; set; set = set->next_retired)
+        n++;
+    return n;
+}
+
+static size_t most_retired;
+
+/* Yields only inside the callback, so one of its publishes is always running */
+static void back_to_back_publisher(void) {
+    int m;
+    for (int i = 0; i < 100; i++)
+        mq_publish(&queue, &m);
+}
+
+static void subscription_churn(void) {
+    for (int i = 0; i < 40; i++) {
+        mq_subscribe(&queue, second_callback, NULL);
+        if (retired_count() > most_retired)
+            most_retired = retired_count();
+        task_yield();
+        mq_unsubscribe(&queue, second_callback, NULL);
+        if (retired_count() > most_retired)
+            most_retired = retired_count();
+        task_yield();
+    }
+}
+
+void test_retired_snapshots_bounded_under_steady_publishing(void) {
+    host_tasks_init();
+    most_retired = 0;
+    mq_subscribe(&queue, yielding_callback, NULL);
+    /* The topic never goes idle while the subscriptions change */
+    host_task_create(back_to_back_publisher, 2);
+    host_task_create(back_to_back_publisher, 2);
+    host_task_create(subscription_churn, 2);
+    host_tasks_run();
+    /* At most the two snapshots the publishers are walking stay retired */
+    TEST_ASSERT_LESS_OR_EQUAL_UINT(2, most_retired);
+    mq_reclaim(&queue);
+    TEST_ASSERT_NULL(queue.retired);
+}
+
+/*
+ * Two publishers on a one-slot MQ_BLOCK queue. The consumer frees the
+ * slot for the blocked publisher, but the other one, released just
+ * before, runs first and takes it.
+ */
+static MQSubQueue_t race_sq;
+static Semaphore_t late_go;
+static int race_msgs[3];
+static void *race_got[3];
+
+static void blocked_racing_publisher(void) {
+    mq_publish(&queue, &race_msgs[0]);
+    mq_publish(&queue, &race_msgs[1]);
+}
+
+static void late_racing_publisher(void) {
+    semaphore_wait(&late_go);
+    mq_publish(&queue, &race_msgs[2]);
+}
+
+static void racing_consumer(void) {
+    semaphore_signal(&late_go);
+    for (int i = 0; i < 3; i++) {
+        mq_queue_receive(&race_sq, &race_got[i]);
+        task_yield();
+    }
+}
+
+void test_queue_block_with_two_publishers_never_overfills(void) {
+    host_tasks_init();
+    semaphore_init(&late_go, 0);
+    mq_subscribe_queue(&queue, &race_sq, 1, MQ_BLOCK, NULL);
+    host_task_create(blocked_racing_publisher, 1);
+    host_task_create(late_racing_publisher, 1);
+    host_task_create(racing_consumer, 2);
+    host_tasks_run();
+    /* The woken publisher found the slot taken and waited again */
+    TEST_ASSERT_EQUAL_PTR(&race_msgs[0], race_got[0]);
+    TEST_ASSERT_EQUAL_PTR(&race_msgs[2], race_got[1]);
+    TEST_ASSERT_EQUAL_PTR(&race_msgs[1], race_got[2]);
+    TEST_ASSERT_EQUAL_UINT(1, race_sq.ipc.peak);
+    TEST_ASSERT_EQUAL_UINT(0, race_sq.ipc.count);
+    TEST_ASSERT_EQUAL_UINT32(0, race_sq.dropped);
+    mq_unsubscribe_queue(&queue, &race_sq);
+}
+
+void test_queue_subscriber_with_filter(void) {
+    MQSubQueue_t sq;
+    MQFilter_t by_device = { offsetof(DeviceMsg_t, device), 2, 0xFFFF, 2 };
+    mq_subscribe_queue(&queue, &sq, 4, MQ_BLOCK, &by_device);
+    DeviceMsg_t a = { 0, 0, 1, 0 };
+    DeviceMsg_t b = { 0, 0, 2, 0 };
+    mq_publish(&queue, &a);
+    mq_publish(&queue, &b);
+    TEST_ASSERT_EQUAL_UINT(1, sq.ipc.count);
+    TEST_ASSERT_EQUAL_UINT32(0, sq.dropped);
+    mq_unsubscribe_queue(&queue, &sq);
+}
+
+void test_queue_subscribe_rejects_bad_args(void) {
+    MQSubQueue_t sq;
+    TEST_ASSERT_EQUAL_INT(-1, mq_subscribe_queue(&queue, &sq, 0, MQ_BLOCK, NULL));
+    TEST_ASSERT_EQUAL_INT(-1, mq_subscribe_queue(&queue, &sq, 2, (MQOverflow_t)7, NULL));
+    TEST_ASSERT_EQUAL_INT(-1, mq_unsubscribe_queue(&queue, &sq));
+}
+
+void test_publish_returns_zero_when_sync(void) {
+    int msg = 1;
+    TEST_ASSERT_EQUAL(MQ_SYNC, queue.mode);
+    TEST_ASSERT_EQUAL_INT(0, mq_publish(&queue, &msg));
+}
+
+void test_async_publish_defers_callbacks(void) {
+    mq_set_mode(&queue, MQ_ASYNC);
+    mq_subscribe(&queue, test_callback, NULL);
+    int msg = 3;
+    TEST_ASSERT_EQUAL_INT(0, mq_publish(&queue, &msg));
+    TEST_ASSERT_EQUAL_INT(0, callback_count);
+
+    TEST_ASSERT_EQUAL_UINT(1, mq_dispatch_pending());
+    TEST_ASSERT_EQUAL_INT(1, callback_count);
+    TEST_ASSERT_EQUAL_PTR(&msg, last_message);
+}
+
+void test_async_dispatch_preserves_order_across_topics(void) {
+    MQ_t other;
+    mq_init(&other);
+    mq_set_mode(&queue, MQ_ASYNC);
+    mq_set_mode(&other, MQ_ASYNC);
+    mq_subscribe(&queue, test_callback, NULL);
+    mq_subscribe(&other, test_callback, NULL);
+
+    int a = 1, b = 2, c = 3;
+    mq_publish(&queue, &a);
+    mq_publish(&other, &b);
+    mq_publish(&queue, &c);
+    TEST_ASSERT_EQUAL_UINT(3, mq_dispatch_pending());
+    TEST_ASSERT_EQUAL_INT(3, callback_count);
+    TEST_ASSERT_EQUAL_PTR(&c, last_message);
+    TEST_ASSERT_EQUAL_UINT(0, mq_dispatch_pending());
+}
+
+void test_async_publish_fails_when_dispatch_queue_full(void) {
+    mq_set_mode(&queue, MQ_ASYNC);
+    int msg = 0;
+    for (int i = 0; i < 4; i++)
+        TEST_ASSERT_EQUAL_INT(0, mq_publish(&queue, &msg));
+    TEST_ASSERT_EQUAL_INT(-1, mq_publish(&queue, &msg));
+    mq_dispatch_pending();
+    TEST_ASSERT_EQUAL_INT(0, mq_publish(&queue, &msg));
+}
+
 int main(void) {
     UNITY_BEGIN();
     RUN_TEST(test_init_subscribers_null);
@@ -114,5 +716,34 @@ int main(void) {
     RUN_TEST(test_subscribe_null_callback);
     RUN_TEST(test_publish_no_subscribers);
     RUN_TEST(test_publish_multiple_times);
+    RUN_TEST(test_subscribers_stored_contiguously);
+    RUN_TEST(test_unsubscribe_last_leaves_null);
+    RUN_TEST(test_unsubscribe_during_publish);
+    RUN_TEST(test_old_snapshot_reclaimed_after_publish);
+    RUN_TEST(test_filtered_subscriber_skips_non_matching);
+    RUN_TEST(test_filter_mask_selects_bits);
+    RUN_TEST(test_filtered_and_unfiltered_mixed);
+    RUN_TEST(test_filters_across_batches);
+    RUN_TEST(test_invalid_filter_rejected);
+    RUN_TEST(test_late_subscriber_gets_retained);
+    RUN_TEST(test_retained_replaced_releases_old);
+    RUN_TEST(test_clear_retained);
+    RUN_TEST(test_retained_respects_filter);
+    RUN_TEST(test_retained_needs_msgbuf_topic);
+    RUN_TEST(test_async_retained_held_until_dispatched);
+    RUN_TEST(test_queue_subscriber_defers_delivery);
+    RUN_TEST(test_queue_drop_newest_counts_drops);
+    RUN_TEST(test_queue_drop_oldest_keeps_latest);
+    RUN_TEST(test_queue_holds_msgbuf_references);
+    RUN_TEST(test_unsubscribe_queue_with_blocked_publisher);
+    RUN_TEST(test_unsubscribe_queue_under_steady_publishing);
+    RUN_TEST(test_retired_snapshots_bounded_under_steady_publishing);
+    RUN_TEST(test_queue_block_with_two_publishers_never_overfills);
+    RUN_TEST(test_queue_subscriber_with_filter);
+    RUN_TEST(test_queue_subscribe_rejects_bad_args);
+    RUN_TEST(test_publish_returns_zero_when_sync);
+    RUN_TEST(test_async_publish_defers_callbacks);
+    RUN_TEST(test_async_dispatch_preserves_order_across_topics);
+    RUN_TEST(test_async_publish_fails_when_dispatch_queue_full);
     return UNITY_END();
 }
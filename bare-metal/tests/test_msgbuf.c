@@ -0,0 +1,145 @@
+#include "unity.h"
+#include "msgbuf.h"
+#include "ipc.h"
+#include "mq.h"
+#include "mem.h"
+#include "scheduler.h"
+#include <pthread.h>
+
+static MsgPool_t pool;
+
+void setUp(void) {
+    init_allocator();
+    scheduler_init();
+    msgpool_init(&pool, 4, 128, 16);
+}
+
+void tearDown(void) {
+    msgpool_destroy(&pool);
+}
+
+void test_pool_init_rejects_empty(void) {
+    MsgPool_t p;
+    TEST_ASSERT_EQUAL_INT(-1, msgpool_init(&p, 0, 64, 0));
+    TEST_ASSERT_EQUAL_INT(-1, msgpool_init(&p, 4, 0, 0));
+}
+
+void test_alloc_until_exhausted(void) {
+    MsgBuf_t *b[4];
+    for (int i = 0; i < 4; i++) {
+        b[i] = msgbuf_alloc(&pool);
+        TEST_ASSERT_NOT_NULL(b[i]);
+        TEST_ASSERT_EQUAL_UINT32(1, b[i]->refs);
+        TEST_ASSERT_EQUAL_UINT(0, b[i]->len);
+        TEST_ASSERT_EQUAL_PTR(&pool, b[i]->pool);
+    }
+    TEST_ASSERT_NULL(msgbuf_alloc(&pool));
+    TEST_ASSERT_EQUAL_UINT(0, pool.available);
+    msgbuf_release(b[2]);
+    TEST_ASSERT_EQUAL_PTR(b[2], msgbuf_alloc(&pool));
+}
+
+void test_buffers_cache_line_aligned(void) {
+    MsgBuf_t *a = msgbuf_alloc(&pool);
+    MsgBuf_t *b = msgbuf_alloc(&pool);
+    TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)a % CACHE_LINE_SIZE);
+    TEST_ASSERT_EQUAL_UINT(0, (uintptr_t)b % CACHE_LINE_SIZE);
+}
+
+void test_last_release_returns_to_pool(void) {
+    MsgBuf_t *mb = msgbuf_alloc(&pool);
+    msgbuf_retain(mb);
+    msgbuf_retain(mb);
+    msgbuf_release(mb);
+    msgbuf_release(mb);
+    TEST_ASSERT_EQUAL_UINT(3, pool.available);
+    msgbuf_release(mb);
+    TEST_ASSERT_EQUAL_UINT(4, pool.available);
+}
+
+void test_put_push_pull_respect_bounds(void) {
+    MsgBuf_t *mb = msgbuf_alloc(&pool);
+    uint8_t *payload = msgbuf_put(mb, 100);
+    TEST_ASSERT_NOT_NULL(payload);
+    TEST_ASSERT_NULL(msgbuf_put(mb, 29));
+    TEST_ASSERT_NOT_NULL(msgbuf_put(mb, 28));
+
+    /* Header lands directly in front of the payload, nothing moves */
+    uint8_t *hdr = msgbuf_push(mb, 16);
+    TEST_ASSERT_EQUAL_PTR(payload - 16, hdr);
+    TEST_ASSERT_EQUAL_UINT(144, mb->len);
+    TEST_ASSERT_NULL(msgbuf_push(mb, 1));
+
+    TEST_ASSERT_EQUAL_PTR(payload, msgbuf_pull(mb, 16));
+    TEST_ASSERT_NULL(msgbuf_pull(mb, 129));
+}
+
+/* --- fan-out: one buffer, two subscribers, each forwarding to a queue --- */
+
+static IPC_t stage[2];
+
+static void forward(void *message, void *context) {
+    msgbuf_retain((MsgBuf_t *)message);
+    ipc_send((IPC_t *)context, message);
+}
+
+void test_fan_out_through_mq_and_ipc_without_copies(void) {
+    MQ_t topic;
+    mq_init(&topic);
+    ipc_init(&stage[0], 2);
+    ipc_init(&stage[1], 2);
+    mq_subscribe(&topic, forward, &stage[0]);
+    mq_subscribe(&topic, forward, &stage[1]);
+
+    MsgBuf_t *mb = msgbuf_alloc(&pool);
+    rt_memcpy(msgbuf_put(mb, 5), "hello", 5);
+    mq_publish(&topic, mb);
+    msgbuf_release(mb);    /* publisher's reference */
+    TEST_ASSERT_EQUAL_UINT32(2, mb->refs);
+
+    for (int i = 0; i < 2; i++) {
+        void *out;
+        ipc_receive(&stage[i], &out);
+        TEST_ASSERT_EQUAL_PTR(mb, out);
+        TEST_ASSERT_EQUAL_MEMORY("hello", ((MsgBuf_t *)out)->data, 5);
+        msgbuf_release((MsgBuf_t *)out);
+    }
+    TEST_ASSERT_EQUAL_UINT(4, pool.available);
+    ipc_destroy(&stage[0]);
+    ipc_destroy(&stage[1]);
+}
+
+#define THREADS 4
+#define ROUNDS  100000
+
+static void *retain_release(void *arg) {
+    MsgBuf_t *mb = (MsgBuf_t *)arg;
+    for (int i = 0; i < ROUNDS; i++) {
+        msgbuf_retain(mb);
+        msgbuf_release(mb);
+    }
+    return NULL;
+}
+
+void test_concurrent_retain_release(void) {
+    MsgBuf_t *mb = msgbuf_alloc(&pool);
+    pthread_t t[THREADS];
+    for (int i = 0; i < THREADS; i++)
+        pthread_create(&t[i], NULL, retain_release, mb);
+    for (int i = 0; i < THREADS; i++)
+        pthread_join(t[i], NULL);
+    TEST_ASSERT_EQUAL_UINT32(1, mb->refs);
+    TEST_ASSERT_EQUAL_UINT(3, pool.available);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_pool_init_rejects_empty);
+    RUN_TEST(test_alloc_until_exhausted);
+    RUN_TEST(test_buffers_cache_line_aligned);
+    RUN_TEST(test_last_release_returns_to_pool);
+    RUN_TEST(test_put_push_pull_respect_bounds);
+    RUN_TEST(test_fan_out_through_mq_and_ipc_without_copies);
+    RUN_TEST(test_concurrent_retain_release);
+    return UNITY_END();
+}
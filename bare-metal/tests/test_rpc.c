@@ -0,0 +1,121 @@
+#include "unity.h"
+#include "ipc.h"
+#include "mem.h"
+#include "scheduler.h"
+#include "host_tasks.h"
+
+#define CALLS 5
+
+static IPCEndpoint_t ep;
+static TCB_t *server_task;
+static int replies[CALLS];
+static int replies_received;
+static uint8_t priority_while_serving;
+static int served_order[4];
+static int served;
+
+/* Echo server: replies with request + 1 until it is asked to stop (0) */
+static void echo_server(void) {
+    void *req;
+    ipc_reply_wait(&ep, NULL, &req);
+    while ((intptr_t)req != 0) {
+        priority_while_serving = current_tcb->priority;
+        served_order[served++ % 4] = (int)(intptr_t)req;
+        ipc_reply_wait(&ep, (void *)((intptr_t)req + 1), &req);
+    }
+    ipc_reply_wait(&ep, NULL, &req);
+}
+
+static void client(void) {
+    void *reply;
+    for (int i = 0; i < CALLS; i++) {
+        if (ipc_call(&ep, (void *)(intptr_t)(10 * (i + 1)), &reply) == 0)
+            replies[replies_received++] = (int)(intptr_t)reply;
+    }
+    ipc_call(&ep, (void *)0, &reply);
+}
+
+void setUp(void) {
+    init_allocator();
+    host_tasks_init();
+    ipc_endpoint_init(&ep);
+    replies_received = 0;
+    priority_while_serving = MAX_PRIORITIES;
+    served = 0;
+}
+
+void tearDown(void) {
+}
+
+void test_call_returns_server_reply(void) {
+    server_task = host_task_create(echo_server, 2);
+    host_task_create(client, 1);
+    host_tasks_run();
+    TEST_ASSERT_EQUAL_INT(CALLS, replies_received);
+    for (int i = 0; i < CALLS; i++)
+        TEST_ASSERT_EQUAL_INT(10 * (i + 1) + 1, replies[i]);
+}
+
+void test_round_trip_is_two_switches(void) {
+    server_task = host_task_create(echo_server, 2);
+    host_task_create(client, 1);
+    host_tasks_run();
+    /* One switch into the server and one back per call, stop included */
+    TEST_ASSERT_EQUAL_UINT32(2 * (CALLS + 1), host_context_switches);
+}
+
+void test_server_inherits_caller_priority(void) {
+    server_task = host_task_create(echo_server, 5);
+    host_task_create(client, 1);
+    host_tasks_run();
+    TEST_ASSERT_EQUAL_UINT8(1, priority_while_serving);
+    TEST_ASSERT_EQUAL_UINT8(5, server_task->priority);
+}
+
+static void caller_low(void) {
+    void *reply;
+    ipc_call(&ep, (void *)3, &reply);
+}
+
+static void caller_high(void) {
+    void *reply;
+    ipc_call(&ep, (void *)1, &reply);
+}
+
+static void caller_mid(void) {
+    void *reply;
+    ipc_call(&ep, (void *)2, &reply);
+}
+
+/* Serves the three queued callers, then exits */
+static void batch_server(void) {
+    void *req;
+    ipc_reply_wait(&ep, NULL, &req);
+    for (int i = 0; i < 3; i++) {
+        served_order[served++] = (int)(intptr_t)req;
+        if (i < 2)
+            ipc_reply_wait(&ep, NULL, &req);
+    }
+}
+
+void test_queued_callers_served_by_priority(void) {
+    /* Callers run first and queue up before the server ever waits */
+    host_task_create(caller_low, 4);
+    host_task_create(caller_high, 2);
+    host_task_create(caller_mid, 3);
+    host_task_create(batch_server, 6);
+    host_tasks_run();
+    TEST_ASSERT_EQUAL_INT(3, served);
+    TEST_ASSERT_EQUAL_INT(1, served_order[0]);
+    TEST_ASSERT_EQUAL_INT(2, served_order[1]);
+    TEST_ASSERT_EQUAL_INT(3, served_order[2]);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_call_returns_server_reply);
+    RUN_TEST(test_round_trip_is_two_switches);
+    RUN_TEST(test_server_inherits_caller_priority);
+    RUN_TEST(test_queued_callers_served_by_priority);
+    return UNITY_END();
+}
@@ -0,0 +1,304 @@
+#define _POSIX_C_SOURCE 200809L
+#include "unity.h"
+#include "rwlock.h"
+#include "scheduler.h"
+#include "host_tasks.h"
+#include <pthread.h>
+
+/* Host stubs */
+uint32_t irq_disable(void) { return 0; }
+void irq_restore(uint32_t flags) { (void)flags; }
+
+static RWLock_t rw;
+static char order[16];
+static int logged;
+static int inside;
+static int max_inside;
+static int rc_a, rc_b;
+
+static void log_event(char c) {
+    order[logged++] = c;
+    order[logged] = '\0';
+}
+
+void setUp(void) {
+    host_tasks_init();
+    rwlock_init(&rw);
+    logged = 0;
+    order[0] = '\0';
+    inside = 0;
+    max_inside = 0;
+    rc_a = rc_b = 1;
+}
+
+void tearDown(void) {
+}
+
+void test_try_locks(void) {
+    TEST_ASSERT_TRUE(rwlock_try_read_lock(&rw));
+    TEST_ASSERT_TRUE(rwlock_try_read_lock(&rw));
+    TEST_ASSERT_FALSE(rwlock_try_write_lock(&rw));
+    TEST_ASSERT_EQUAL_UINT32(2, rw.state);
+    rwlock_read_unlock(&rw);
+    rwlock_read_unlock(&rw);
+
+    TEST_ASSERT_TRUE(rwlock_try_write_lock(&rw));
+    TEST_ASSERT_FALSE(rwlock_try_read_lock(&rw));
+    TEST_ASSERT_FALSE(rwlock_try_write_lock(&rw));
+    rwlock_write_unlock(&rw);
+    TEST_ASSERT_EQUAL_UINT32(0, rw.state);
+    TEST_ASSERT_FALSE(rw.lock.locked);
+}
+
+static void sharing_reader(void) {
+    rwlock_read_lock(&rw);
+    if (++inside > max_inside)
+        max_inside = inside;
+    task_yield();
+    inside--;
+    rwlock_read_unlock(&rw);
+}
+
+void test_readers_share(void) {
+    host_task_create(sharing_reader, 2);
+    host_task_create(sharing_reader, 2);
+    host_task_create(sharing_reader, 2);
+    host_tasks_run();
+    TEST_ASSERT_EQUAL_INT(3, max_inside);
+    TEST_ASSERT_EQUAL_UINT32(0, rw.state);
+}
+
+static void holding_writer(void) {
+    rwlock_write_lock(&rw);
+    log_event('W');
+    task_yield();
+    log_event('w');
+    rwlock_write_unlock(&rw);
+}
+
+static void logging_reader(void) {
+    rc_a = rwlock_read_lock(&rw);
+    log_event('R');
+    rwlock_read_unlock(&rw);
+}
+
+void test_writer_excludes_readers(void) {
+    host_task_create(holding_writer, 2);
+    host_task_create(logging_reader, 2);
+    host_tasks_run();
+    TEST_ASSERT_EQUAL_STRING("WwR", order);
+    TEST_ASSERT_EQUAL_INT(0, rc_a);
+    TEST_ASSERT_EQUAL_UINT32(0, rw.state);
+}
+
+static void slow_reader(void) {
+    rwlock_read_lock(&rw);
+    log_event('1');
+    task_yield();
+    task_yield();
+    log_event('d');
+    rwlock_read_unlock(&rw);
+}
+
+static void logging_writer(void) {
+    rwlock_write_lock(&rw);
+    log_event('W');
+    rwlock_write_unlock(&rw);
+}
+
+static void late_reader(void) {
+    rwlock_read_lock(&rw);
+    log_event('2');
+    rwlock_read_unlock(&rw);
+}
+
+void test_waiting_writer_blocks_new_readers(void) {
+    host_task_create(slow_reader, 2);
+    host_task_create(logging_writer, 2);
+    host_task_create(late_reader, 2);
+    host_tasks_run();
+    /* The lock was read-held, yet the second reader waited for the writer */
+    TEST_ASSERT_EQUAL_STRING("1dW2", order);
+    TEST_ASSERT_EQUAL_UINT32(0, rw.state);
+}
+
+static void writer_p1(void) {
+    rwlock_write_lock(&rw);
+    log_event('1');
+    rwlock_write_unlock(&rw);
+}
+
+static void writer_p3(void) {
+    rwlock_write_lock(&rw);
+    log_event('3');
+    rwlock_write_unlock(&rw);
+}
+
+static void reader_p1(void) {
+    rwlock_read_lock(&rw);
+    log_event('r');
+    rwlock_read_unlock(&rw);
+}
+
+static void writer_queues_p3_then_p1(void) {
+    rwlock_write_lock(&rw);
+    host_task_create(writer_p3, 3);
+    task_yield();
+    host_task_create(writer_p1, 1);
+    task_yield();
+    rwlock_write_unlock(&rw);
+}
+
+void test_writers_woken_by_priority(void) {
+    host_task_create(writer_queues_p3_then_p1, 5);
+    host_tasks_run();
+    TEST_ASSERT_EQUAL_STRING("13", order);
+}
+
+static void writer_queues_writer_then_reader(void) {
+    rwlock_write_lock(&rw);
+    host_task_create(writer_p3, 3);
+    task_yield();
+    host_task_create(reader_p1, 1);
+    task_yield();
+    rwlock_write_unlock(&rw);
+}
+
+void test_higher_priority_reader_goes_before_writer(void) {
+    host_task_create(writer_queues_writer_then_reader, 5);
+    host_tasks_run();
+    TEST_ASSERT_EQUAL_STRING("r3", order);
+    TEST_ASSERT_EQUAL_UINT32(0, rw.state);
+}
+
+static void upgrading_reader(void) {
+    rwlock_read_lock(&rw);
+    task_yield();
+    rc_a = rwlock_upgrade(&rw);
+    log_event((rw.state & RWLOCK_WRITER) ? 'A' : 'x');
+    rwlock_write_unlock(&rw);
+}
+
+static void other_reader(void) {
+    rwlock_read_lock(&rw);
+    task_yield();
+    log_event('b');
+    rwlock_read_unlock(&rw);
+}
+
+void test_upgrade_waits_for_readers_and_beats_writers(void) {
+    host_task_create(upgrading_reader, 2);
+    host_task_create(other_reader, 2);
+    host_task_create(logging_writer, 2);
+    host_tasks_run();
+    TEST_ASSERT_EQUAL_INT(0, rc_a);
+    TEST_ASSERT_EQUAL_STRING("bAW", order);
+    TEST_ASSERT_EQUAL_UINT32(0, rw.state);
+}
+
+void test_upgrade_sole_reader_is_immediate(void) {
+    rwlock_read_lock(&rw);
+    TEST_ASSERT_EQUAL_INT(0, rwlock_upgrade(&rw));
+    TEST_ASSERT_EQUAL_UINT32(RWLOCK_WRITER, rw.state);
+    rwlock_write_unlock(&rw);
+}
+
+static void second_upgrader(void) {
+    rwlock_read_lock(&rw);
+    task_yield();
+    rc_b = rwlock_upgrade(&rw);
+    /* Refused: still a reader, so step aside for the first upgrader */
+    rwlock_read_unlock(&rw);
+}
+
+void test_second_upgrader_refused(void) {
+    host_task_create(upgrading_reader, 2);
+    host_task_create(second_upgrader, 2);
+    host_tasks_run();
+    TEST_ASSERT_EQUAL_INT(0, rc_a);
+    TEST_ASSERT_EQUAL_INT(-1, rc_b);
+    TEST_ASSERT_EQUAL_STRING("A", order);
+    TEST_ASSERT_EQUAL_UINT32(0, rw.state);
+}
+
+static void downgrading_writer(void) {
+    rwlock_write_lock(&rw);
+    task_yield();
+    rwlock_downgrade(&rw);
+    max_inside = (int)(rw.state & RWLOCK_READERS);
+    rwlock_read_unlock(&rw);
+}
+
+void test_downgrade_admits_waiting_readers(void) {
+    host_task_create(downgrading_writer, 2);
+    host_task_create(reader_p1, 2);
+    host_task_create(reader_p1, 2);
+    host_tasks_run();
+    TEST_ASSERT_EQUAL_INT(3, max_inside);
+    TEST_ASSERT_EQUAL_STRING("rr", order);
+    TEST_ASSERT_EQUAL_UINT32(0, rw.state);
+}
+
+/* --- SMP: pthreads stand in for cores on the lock-free paths --- */
+
+#define SMP_READERS 3
+#define SMP_READS   100000
+#define SMP_WRITES  10000
+
+static volatile uint32_t table[2];
+static volatile int torn_reads;
+
+static void *smp_reader(void *arg) {
+    (void)arg;
+    for (int i = 0; i < SMP_READS; i++) {
+        while (!rwlock_try_read_lock(&rw))
+            cpu_relax();
+        if (table[0] != table[1])
+            __atomic_add_fetch(&torn_reads, 1, __ATOMIC_RELAXED);
+        rwlock_read_unlock(&rw);
+    }
+    return NULL;
+}
+
+static void *smp_writer(void *arg) {
+    (void)arg;
+    for (int i = 0; i < SMP_WRITES; i++) {
+        while (!rwlock_try_write_lock(&rw))
+            cpu_relax();
+        table[0]++;
+        table[1]++;
+        rwlock_write_unlock(&rw);
+    }
+    return NULL;
+}
+
+void test_smp_readers_and_writer(void) {
+    pthread_t readers[SMP_READERS], writer;
+    table[0] = table[1] = 0;
+    torn_reads = 0;
+    for (int i = 0; i < SMP_READERS; i++)
+        pthread_create(&readers[i], NULL, smp_reader, NULL);
+    pthread_create(&writer, NULL, smp_writer, NULL);
+    for (int i = 0; i < SMP_READERS; i++)
+        pthread_join(readers[i], NULL);
+    pthread_join(writer, NULL);
+    TEST_ASSERT_EQUAL_INT(0, torn_reads);
+    TEST_ASSERT_EQUAL_UINT32(SMP_WRITES, table[0]);
+    TEST_ASSERT_EQUAL_UINT32(0, rw.state);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_try_locks);
+    RUN_TEST(test_readers_share);
+    RUN_TEST(test_writer_excludes_readers);
+    RUN_TEST(test_waiting_writer_blocks_new_readers);
+    RUN_TEST(test_writers_woken_by_priority);
+    RUN_TEST(test_higher_priority_reader_goes_before_writer);
+    RUN_TEST(test_upgrade_waits_for_readers_and_beats_writers);
+    RUN_TEST(test_upgrade_sole_reader_is_immediate);
+    RUN_TEST(test_second_upgrader_refused);
+    RUN_TEST(test_downgrade_admits_waiting_readers);
+    RUN_TEST(test_smp_readers_and_writer);
+    return UNITY_END();
+}
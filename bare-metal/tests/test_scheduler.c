@@ -162,6 +162,18 @@ void test_multiple_priorities_interleave(void) {
     TEST_ASSERT_EQUAL_PTR(low, s3);
 }
 
+void test_set_priority_requeues_ready_task(void) {
+    TCB_t *low = make_task(4);
+    TCB_t *mid = make_task(2);
+
+    scheduler_set_priority(low, 1);
+    TEST_ASSERT_EQUAL_UINT8(1, low->priority);
+    TEST_ASSERT_EQUAL_PTR(low, scheduler_select_next());
+    TEST_ASSERT_EQUAL_PTR(mid, scheduler_select_next());
+    /* The old level must not still hold the task */
+    TEST_ASSERT_EQUAL_PTR(mid, scheduler_select_next());
+}
+
 int main(void) {
     UNITY_BEGIN();
     RUN_TEST(test_select_highest_priority);
@@ -172,5 +184,6 @@ int main(void) {
     RUN_TEST(test_blocked_task_skipped);
     RUN_TEST(test_empty_returns_current);
     RUN_TEST(test_multiple_priorities_interleave);
+    RUN_TEST(test_set_priority_requeues_ready_task);
     return UNITY_END();
 }
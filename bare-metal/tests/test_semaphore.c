@@ -2,8 +2,10 @@
 #include "semaphore.h"
 #include "scheduler.h"
 
-/* Host stubs for irq_disable/irq_restore */
-uint32_t irq_disable(void) { return 0; }
+/* Host stubs for irq_disable/irq_restore; count slow-path entries */
+static int irq_disabled;
+
+uint32_t irq_disable(void) { irq_disabled++; return 0; }
 void irq_restore(uint32_t flags) { (void)flags; }
 
 /* Track whether task_yield was called */
@@ -32,6 +34,7 @@ static TCB_t *setup_current_task(uint8_t priority) {
 void setUp(void) {
     scheduler_init();
     yield_called = 0;
+    irq_disabled = 0;
 }
 
 void tearDown(void) {
@@ -130,6 +133,59 @@ void test_multiple_waiters(void) {
     TEST_ASSERT_EQUAL(TASK_STATE_READY, t1->state);
 }
 
+void test_uncontended_stays_on_fast_path(void) {
+    Semaphore_t sem;
+    semaphore_init(&sem, 1);
+    setup_current_task(1);
+
+    for (int i = 0; i < 10; i++) {
+        semaphore_wait(&sem);
+        semaphore_signal(&sem);
+    }
+    TEST_ASSERT_EQUAL_INT(1, sem.count);
+    TEST_ASSERT_EQUAL_INT(0, irq_disabled);
+    TEST_ASSERT_FALSE(sem.lock.locked);
+}
+
+void test_block_and_wake_take_slow_path(void) {
+    Semaphore_t sem;
+    semaphore_init(&sem, 0);
+    TCB_t *task = setup_current_task(1);
+
+    semaphore_wait(&sem);
+    TEST_ASSERT_EQUAL_INT(1, irq_disabled);
+    semaphore_signal(&sem);
+    TEST_ASSERT_EQUAL_INT(2, irq_disabled);
+    TEST_ASSERT_EQUAL(TASK_STATE_READY, task->state);
+    TEST_ASSERT_EQUAL_INT(0, sem.count);
+
+    /* No waiters left: back on the fast path */
+    semaphore_signal(&sem);
+    TEST_ASSERT_EQUAL_INT(2, irq_disabled);
+    TEST_ASSERT_EQUAL_INT(1, sem.count);
+}
+
+void test_enqueue_if_held(void) {
+    Semaphore_t sem;
+    semaphore_init(&sem, 1);
+    TCB_t *task = setup_current_task(1);
+    task->state = TASK_STATE_BLOCKED;
+
+    /* Available: the caller should wake the task normally */
+    TEST_ASSERT_FALSE(semaphore_enqueue_if_held(&sem, task));
+    TEST_ASSERT_EQUAL_INT(1, sem.count);
+
+    semaphore_wait(&sem);
+    TEST_ASSERT_TRUE(semaphore_enqueue_if_held(&sem, task));
+    TEST_ASSERT_EQUAL_INT(-1, sem.count);
+    TEST_ASSERT_EQUAL_PTR(task, sem.waiting);
+
+    /* Releasing hands the semaphore to the queued task */
+    semaphore_signal(&sem);
+    TEST_ASSERT_EQUAL(TASK_STATE_READY, task->state);
+    TEST_ASSERT_EQUAL_INT(0, sem.count);
+}
+
 int main(void) {
     UNITY_BEGIN();
     RUN_TEST(test_init);
@@ -139,5 +195,8 @@ int main(void) {
     RUN_TEST(test_signal_unblocks_waiter);
     RUN_TEST(test_counting_semaphore);
     RUN_TEST(test_multiple_waiters);
+    RUN_TEST(test_uncontended_stays_on_fast_path);
+    RUN_TEST(test_block_and_wake_take_slow_path);
+    RUN_TEST(test_enqueue_if_held);
     return UNITY_END();
 }
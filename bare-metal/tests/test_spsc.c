@@ -0,0 +1,195 @@
+#define _POSIX_C_SOURCE 200809L
+#include "unity.h"
+#include "spsc.h"
+#include "mem.h"
+#include "scheduler.h"
+#include <pthread.h>
+#include <sched.h>
+
+/* Host stubs */
+uint32_t irq_disable(void) { return 0; }
+void irq_restore(uint32_t flags) { (void)flags; }
+
+static int yield_called;
+static void (*on_yield)(void);
+void task_yield(void) {
+    yield_called++;
+    if (on_yield)
+        on_yield();
+}
+
+extern TCB_t *scheduler_get_task_pool(void);
+
+static SPSC_t ring;
+static int notify_count;
+
+static void count_notify(void *context) {
+    (void)context;
+    notify_count++;
+}
+
+static TCB_t *setup_current_task(uint8_t priority) {
+    TCB_t *pool = scheduler_get_task_pool();
+    for (int i = 0; i < MAX_TASKS; i++) {
+        if (pool[i].state == TASK_STATE_DEAD) {
+            pool[i].priority = priority;
+            pool[i].state = TASK_STATE_RUNNING;
+            pool[i].next = NULL;
+            current_tcb = &pool[i];
+            return &pool[i];
+        }
+    }
+    return NULL;
+}
+
+void setUp(void) {
+    init_allocator();
+    scheduler_init();
+    yield_called = 0;
+    on_yield = NULL;
+    notify_count = 0;
+    spsc_init(&ring, 4);
+    setup_current_task(1);
+}
+
+void tearDown(void) {
+    spsc_destroy(&ring);
+}
+
+void test_init_requires_power_of_two(void) {
+    SPSC_t r;
+    TEST_ASSERT_EQUAL_INT(-1, spsc_init(&r, 6));
+    TEST_ASSERT_EQUAL_INT(-1, spsc_init(&r, 1));
+    TEST_ASSERT_EQUAL_INT(0, spsc_init(&r, 8));
+    TEST_ASSERT_EQUAL_UINT32(7, r.mask);
+    spsc_destroy(&r);
+}
+
+void test_indices_on_separate_cache_lines(void) {
+    uintptr_t h = (uintptr_t)&ring.head / CACHE_LINE_SIZE;
+    uintptr_t t = (uintptr_t)&ring.tail / CACHE_LINE_SIZE;
+    TEST_ASSERT_NOT_EQUAL(h, t);
+}
+
+void test_push_pop_fifo(void) {
+    for (uintptr_t i = 1; i <= 3; i++)
+        TEST_ASSERT_EQUAL_INT(0, spsc_push(&ring, i));
+    TEST_ASSERT_EQUAL_UINT(3, spsc_count(&ring));
+    uintptr_t v;
+    for (uintptr_t i = 1; i <= 3; i++) {
+        TEST_ASSERT_EQUAL_INT(0, spsc_pop(&ring, &v));
+        TEST_ASSERT_EQUAL_UINT(i, v);
+    }
+    TEST_ASSERT_EQUAL_INT(-1, spsc_pop(&ring, &v));
+}
+
+void test_push_full_fails(void) {
+    for (uintptr_t i = 0; i < 4; i++)
+        TEST_ASSERT_EQUAL_INT(0, spsc_push(&ring, i));
+    TEST_ASSERT_EQUAL_INT(-1, spsc_push(&ring, 99));
+    uintptr_t v;
+    spsc_pop(&ring, &v);
+    TEST_ASSERT_EQUAL_INT(0, spsc_push(&ring, 99));
+}
+
+void test_wraparound(void) {
+    uintptr_t v;
+    for (uintptr_t i = 0; i < 1000; i++) {
+        TEST_ASSERT_EQUAL_INT(0, spsc_push(&ring, i));
+        TEST_ASSERT_EQUAL_INT(0, spsc_pop(&ring, &v));
+        TEST_ASSERT_EQUAL_UINT(i, v);
+    }
+}
+
+void test_notify_hook_called_per_push(void) {
+    int ctx;
+    spsc_set_notify(&ring, count_notify, &ctx);
+    spsc_push(&ring, 1);
+    spsc_push(&ring, 2);
+    TEST_ASSERT_EQUAL_INT(2, notify_count);
+}
+
+void test_pop_wait_blocks_when_empty(void) {
+    TCB_t *task = setup_current_task(1);
+    uintptr_t v;
+    /* The stub yield returns without a push: the waiter is withdrawn */
+    TEST_ASSERT_EQUAL_INT(-1, spsc_pop_wait(&ring, &v));
+    TEST_ASSERT_EQUAL_INT(1, yield_called);
+    TEST_ASSERT_EQUAL(TASK_STATE_RUNNING, task->state);
+    TEST_ASSERT_NULL(ring.waiter);
+}
+
+static TCB_t *blocked_consumer;
+static uint32_t state_at_push;
+
+/* Producer runs in "ISR" context while the consumer sleeps */
+static void push_while_blocked(void) {
+    state_at_push = blocked_consumer->state;
+    spsc_push(&ring, 7);
+}
+
+void test_push_wakes_waiting_consumer(void) {
+    blocked_consumer = setup_current_task(1);
+    on_yield = push_while_blocked;
+    uintptr_t v = 0;
+    TEST_ASSERT_EQUAL_INT(0, spsc_pop_wait(&ring, &v));
+    TEST_ASSERT_EQUAL_UINT(7, v);
+    TEST_ASSERT_EQUAL(TASK_STATE_BLOCKED, state_at_push);
+    TEST_ASSERT_EQUAL(TASK_STATE_READY, blocked_consumer->state);
+    TEST_ASSERT_NULL(ring.waiter);
+}
+
+void test_pop_wait_returns_available_item(void) {
+    spsc_push(&ring, 5);
+    uintptr_t v = 0;
+    TEST_ASSERT_EQUAL_INT(0, spsc_pop_wait(&ring, &v));
+    TEST_ASSERT_EQUAL_UINT(5, v);
+    TEST_ASSERT_EQUAL_INT(0, yield_called);
+}
+
+#define STREAM_ITEMS 200000
+
+static void *producer_thread(void *arg) {
+    SPSC_t *r = (SPSC_t *)arg;
+    for (uintptr_t i = 0; i < STREAM_ITEMS; i++) {
+        while (spsc_push(r, i) != 0)
+            sched_yield();
+    }
+    return NULL;
+}
+
+void test_concurrent_stream_in_order(void) {
+    SPSC_t r;
+    spsc_init(&r, 64);
+    pthread_t t;
+    pthread_create(&t, NULL, producer_thread, &r);
+    uintptr_t expect = 0, v;
+    int errors = 0;
+    while (expect < STREAM_ITEMS) {
+        if (spsc_pop(&r, &v) == 0) {
+            if (v != expect)
+                errors++;
+            expect++;
+        } else {
+            sched_yield();
+        }
+    }
+    pthread_join(t, NULL);
+    TEST_ASSERT_EQUAL_INT(0, errors);
+    spsc_destroy(&r);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_init_requires_power_of_two);
+    RUN_TEST(test_indices_on_separate_cache_lines);
+    RUN_TEST(test_push_pop_fifo);
+    RUN_TEST(test_push_full_fails);
+    RUN_TEST(test_wraparound);
+    RUN_TEST(test_notify_hook_called_per_push);
+    RUN_TEST(test_pop_wait_blocks_when_empty);
+    RUN_TEST(test_push_wakes_waiting_consumer);
+    RUN_TEST(test_pop_wait_returns_available_item);
+    RUN_TEST(test_concurrent_stream_in_order);
+    return UNITY_END();
+}
@@ -0,0 +1,143 @@
+#include "unity.h"
+#include "stream.h"
+#include "mem.h"
+#include "scheduler.h"
+
+/* Host stubs */
+uint32_t irq_disable(void) { return 0; }
+void irq_restore(uint32_t flags) { (void)flags; }
+
+static int yield_called;
+void task_yield(void) { yield_called++; }
+
+extern TCB_t *scheduler_get_task_pool(void);
+
+static Stream_t stream;
+
+static TCB_t *setup_current_task(uint8_t priority) {
+    TCB_t *pool = scheduler_get_task_pool();
+    for (int i = 0; i < MAX_TASKS; i++) {
+        if (pool[i].state == TASK_STATE_DEAD) {
+            pool[i].priority = priority;
+            pool[i].state = TASK_STATE_RUNNING;
+            pool[i].next = NULL;
+            current_tcb = &pool[i];
+            return &pool[i];
+        }
+    }
+    return NULL;
+}
+
+void setUp(void) {
+    init_allocator();
+    scheduler_init();
+    yield_called = 0;
+    stream_init(&stream, 8);
+    setup_current_task(1);
+}
+
+void tearDown(void) {
+    stream_destroy(&stream);
+}
+
+void test_init_and_destroy(void) {
+    Stream_t s;
+    TEST_ASSERT_EQUAL_INT(-1, stream_init(&s, 0));
+    TEST_ASSERT_EQUAL_INT(0, stream_init(&s, 16));
+    TEST_ASSERT_EQUAL_UINT(16, s.size);
+    TEST_ASSERT_EQUAL_UINT(0, stream_available(&s));
+    stream_destroy(&s);
+    TEST_ASSERT_NULL(s.buffer);
+}
+
+void test_write_read_round_trip(void) {
+    TEST_ASSERT_EQUAL_UINT(5, stream_write(&stream, "hello", 5));
+    TEST_ASSERT_EQUAL_UINT(5, stream_available(&stream));
+    char out[8] = { 0 };
+    TEST_ASSERT_EQUAL_UINT(5, stream_read(&stream, out, sizeof(out), 1));
+    TEST_ASSERT_EQUAL_STRING("hello", out);
+    TEST_ASSERT_EQUAL_INT(0, yield_called);
+}
+
+void test_wraparound_preserves_bytes(void) {
+    uint8_t in[5], out[5];
+    for (uint8_t round = 0; round < 20; round++) {
+        for (uint8_t i = 0; i < 5; i++)
+            in[i] = (uint8_t)(round * 5 + i);
+        stream_write(&stream, in, 5);
+        TEST_ASSERT_EQUAL_UINT(5, stream_read(&stream, out, 5, 5));
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(in, out, 5);
+    }
+}
+
+void test_read_returns_at_most_maxlen(void) {
+    stream_write(&stream, "abcdef", 6);
+    char out[4];
+    TEST_ASSERT_EQUAL_UINT(4, stream_read(&stream, out, 4, 1));
+    TEST_ASSERT_EQUAL_MEMORY("abcd", out, 4);
+    TEST_ASSERT_EQUAL_UINT(2, stream_available(&stream));
+}
+
+void test_reader_woken_only_at_trigger_level(void) {
+    TCB_t *reader = setup_current_task(1);
+    char out[8];
+    stream_read(&stream, out, sizeof(out), 4);
+    TEST_ASSERT_EQUAL(TASK_STATE_BLOCKED, reader->state);
+    stream.reader = reader;  /* the stub yield returned; re-arm the wait */
+    stream.trigger = 4;
+
+    setup_current_task(1);
+    stream_write(&stream, "ab", 2);
+    TEST_ASSERT_EQUAL(TASK_STATE_BLOCKED, reader->state);
+    stream_write(&stream, "cd", 2);
+    TEST_ASSERT_EQUAL(TASK_STATE_READY, reader->state);
+    TEST_ASSERT_NULL(stream.reader);
+}
+
+void test_trigger_clamped_to_maxlen(void) {
+    stream_write(&stream, "xy", 2);
+    char out[2];
+    /* Asking for 6 bytes but only room for 2 must not block */
+    TEST_ASSERT_EQUAL_UINT(2, stream_read(&stream, out, 2, 6));
+    TEST_ASSERT_EQUAL_INT(0, yield_called);
+}
+
+void test_write_full_blocks_and_returns_partial(void) {
+    TCB_t *writer = setup_current_task(1);
+    TEST_ASSERT_EQUAL_UINT(8, stream_write(&stream, "0123456789", 10));
+    TEST_ASSERT_EQUAL_INT(1, yield_called);
+    TEST_ASSERT_EQUAL(TASK_STATE_BLOCKED, writer->state);
+}
+
+void test_read_wakes_blocked_writer(void) {
+    stream_write(&stream, "01234567", 8);
+    TCB_t *writer = setup_current_task(1);
+    stream_write(&stream, "8", 1);
+    stream.writer = writer;
+
+    setup_current_task(1);
+    char out[2];
+    stream_read(&stream, out, 2, 1);
+    TEST_ASSERT_EQUAL(TASK_STATE_READY, writer->state);
+    TEST_ASSERT_NULL(stream.writer);
+}
+
+void test_try_write_never_blocks(void) {
+    TEST_ASSERT_EQUAL_UINT(8, stream_try_write(&stream, "0123456789", 10));
+    TEST_ASSERT_EQUAL_UINT(0, stream_try_write(&stream, "x", 1));
+    TEST_ASSERT_EQUAL_INT(0, yield_called);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_init_and_destroy);
+    RUN_TEST(test_write_read_round_trip);
+    RUN_TEST(test_wraparound_preserves_bytes);
+    RUN_TEST(test_read_returns_at_most_maxlen);
+    RUN_TEST(test_reader_woken_only_at_trigger_level);
+    RUN_TEST(test_trigger_clamped_to_maxlen);
+    RUN_TEST(test_write_full_blocks_and_returns_partial);
+    RUN_TEST(test_read_wakes_blocked_writer);
+    RUN_TEST(test_try_write_never_blocks);
+    return UNITY_END();
+}